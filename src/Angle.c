@@ -0,0 +1,100 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+
+#include <avr/pgmspace.h>
+
+#include "Angle.h"
+
+// atan(i / 64) for i = 0 to 64 (1/800 degree)
+
+static const uint16_t Angle_table[] PROGMEM =
+{
+	    0,   716,  1432,  2147,  2861,  3574,  4285,  4994,
+	 5700,  6404,  7105,  7802,  8496,  9186,  9871, 10552,
+	11229, 11901, 12567, 13228, 13883, 14533, 15176, 15814,
+	16445, 17069, 17688, 18299, 18904, 19501, 20092, 20676,
+	21252, 21821, 22384, 22939, 23486, 24027, 24560, 25086,
+	25604, 26116, 26620, 27117, 27607, 28090, 28565, 29034,
+	29496, 29951, 30399, 30840, 31275, 31703, 32125, 32540,
+	32949, 33351, 33748, 34138, 34522, 34900, 35272, 35639,
+	36000
+};
+
+// Returns atan2(y, x) in hundredths of a degree, from -18000 to 18000,
+// or 0 when both are 0. The result is within 0.01 degree of the exact
+// angle for all arguments (see tools/angle).
+//
+// The smaller magnitude over the larger gives the tangent within the first
+// octant, which is interpolated in the table and then reflected into the
+// other octants. This takes one 32-bit division and no floating point.
+
+int16_t Angle_Atan2(
+	int32_t y,
+	int32_t x)
+{
+	uint32_t ax = (x < 0) ? -(uint32_t) x : (uint32_t) x;
+	uint32_t ay = (y < 0) ? -(uint32_t) y : (uint32_t) y;
+	uint32_t a, b, tangent;
+	uint16_t i, lo, frac;
+	int16_t angle;
+
+	if (ax >= ay)
+	{
+		a = ax;
+		b = ay;
+	}
+	else
+	{
+		a = ay;
+		b = ax;
+	}
+
+	if (a == 0) return 0;
+
+	// Keep b << 16 within 32 bits
+
+	while (a >= 0x10000)
+	{
+		a >>= 1;
+		b >>= 1;
+	}
+
+	tangent = (b << 16) / a; // 0 to 65536
+
+	i    = tangent >> 10;
+	frac = tangent & 0x3ff;
+	lo   = pgm_read_word(&Angle_table[i]);
+
+	if (frac)
+	{
+		lo += ((uint32_t) (pgm_read_word(&Angle_table[i + 1]) - lo) * frac + 512) >> 10;
+	}
+
+	angle = (lo + 4) >> 3;
+
+	if (ay > ax) angle = 9000 - angle;
+	if (x < 0)   angle = 18000 - angle;
+
+	return (y < 0) ? -angle : angle;
+}
@@ -0,0 +1,31 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef MGC_ANGLE_H
+#define MGC_ANGLE_H
+
+#include <stdint.h>
+
+int16_t Angle_Atan2(int32_t y, int32_t x);
+
+#endif
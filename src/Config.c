@@ -33,6 +33,7 @@
 #include "Debug.h"
 #include "Log.h"
 #include "Main.h"
+#include "Predict.h"
 #include "Tone.h"
 #include "UBX.h"
 #include "Version.h"
@@ -62,6 +63,7 @@ Model:     7     ; Dynamic model\r\n\
                  ;   7 = Airborne with < 2 G acceleration\r\n\
                  ;   8 = Airborne with < 4 G acceleration\r\n\
 Rate:      200   ; Measurement rate (ms)\r\n\
+                 ;   40 to 100 = High-rate mode\r\n\
 \r\n\
 ; Tone settings\r\n\
 \r\n\
@@ -86,6 +88,12 @@ Limits:    1     ; Behaviour when outside bounds\r\n\
                  ;   2 = Chirp up/down\r\n\
                  ;   3 = Chirp down/up\r\n\
 Volume:    6     ; 0 (min) to 8 (max)\r\n\
+Tone_Int:  0     ; Tone update interval (ms)\r\n\
+                 ;   0 = Every measurement\r\n\
+Glide:     0     ; Time for a beep to glide across all pitches (ms)\r\n\
+                 ;   0 = Pitch is fixed for each beep\r\n\
+Lead:      0     ; Extrapolate tone values ahead by (ms)\r\n\
+                 ;   0 = Use the latest measurement\r\n\
 \r\n\
 ; Rate settings\r\n\
 \r\n\
@@ -151,6 +159,21 @@ TZ_Offset: 0     ; Timezone offset of output files in seconds\r\n\
                  ;   -21600 = UTC-6 (CST, MDT)\r\n\
                  ;   -25200 = UTC-7 (MST, PDT)\r\n\
                  ;   -28800 = UTC-8 (PST)\r\n\
+Log_Track: 1     ; Decoded track format\r\n\
+                 ;   0 = None\r\n\
+                 ;   1 = Text (.csv)\r\n\
+                 ;   2 = Binary (.trk)\r\n\
+Log_Raw:   0     ; Write raw receiver output (.ubx)\r\n\
+                 ;   0 = No\r\n\
+                 ;   1 = Yes\r\n\
+Log_Len:   30    ; Longest jump to reserve log space for (min)\r\n\
+                 ;   0 = No reservation\r\n\
+Sync_Rows: 5     ; Most rows lost if power is cut (1 to 255)\r\n\
+Sync_Int:  1000  ; Most time lost if power is cut (ms)\r\n\
+                 ;   0 = No limit\r\n\
+Sync_Phase: 0    ; Save log on flight phase changes\r\n\
+                 ;   0 = No\r\n\
+                 ;   1 = Yes\r\n\
 \r\n\
 ; Initialization\r\n\
 \r\n\
@@ -223,6 +246,9 @@ static const char Config_Min[] PROGMEM        = "Min";
 static const char Config_Max[] PROGMEM        = "Max";
 static const char Config_Limits[] PROGMEM     = "Limits";
 static const char Config_Volume[] PROGMEM     = "Volume";
+static const char Config_Tone_Int[] PROGMEM   = "Tone_Int";
+static const char Config_Glide[] PROGMEM      = "Glide";
+static const char Config_Lead[] PROGMEM       = "Lead";
 static const char Config_Mode_2[] PROGMEM     = "Mode_2";
 static const char Config_Min_Val_2[] PROGMEM  = "Min_Val_2";
 static const char Config_Max_Val_2[] PROGMEM  = "Max_Val_2";
@@ -245,6 +271,12 @@ static const char Config_Alarm_Elev[] PROGMEM = "Alarm_Elev";
 static const char Config_Alarm_Type[] PROGMEM = "Alarm_Type";
 static const char Config_Alarm_File[] PROGMEM = "Alarm_File";
 static const char Config_TZ_Offset[] PROGMEM  = "TZ_Offset";
+static const char Config_Log_Track[] PROGMEM  = "Log_Track";
+static const char Config_Log_Raw[] PROGMEM    = "Log_Raw";
+static const char Config_Log_Len[] PROGMEM    = "Log_Len";
+static const char Config_Sync_Rows[] PROGMEM  = "Sync_Rows";
+static const char Config_Sync_Int[] PROGMEM   = "Sync_Int";
+static const char Config_Sync_Phase[] PROGMEM = "Sync_Phase";
 static const char Config_Init_Mode[] PROGMEM  = "Init_Mode";
        const char Config_Init_File[] PROGMEM  = "Init_File";
 static const char Config_Win_Top[] PROGMEM    = "Win_Top";
@@ -302,12 +334,15 @@ static FRESULT Config_ReadSingle(
 			if ((t) && !strcmp_P(name, (s))) { (w) = (r); }
 
 		HANDLE_VALUE(Config_Model,     UBX_model,        val, val >= 0 && val <= 8);
-		HANDLE_VALUE(Config_Rate,      UBX_rate,         val, val >= 100);
+		HANDLE_VALUE(Config_Rate,      UBX_rate,         val, val >= 40);
 		HANDLE_VALUE(Config_Mode,      UBX_mode,         val, (val >= 0 && val <= 4) || (val == 11));
 		HANDLE_VALUE(Config_Min,       UBX_min,          val, TRUE);
 		HANDLE_VALUE(Config_Max,       UBX_max,          val, TRUE);
 		HANDLE_VALUE(Config_Limits,    UBX_limits,       val, val >= 0 && val <= 2);
 		HANDLE_VALUE(Config_Volume,    Tone_volume,      8 - val, val >= 0 && val <= 8);
+		HANDLE_VALUE(Config_Tone_Int,  UBX_tone_int,     val, val >= 0 && val <= 10000);
+		HANDLE_VALUE(Config_Glide,     Tone_glide,       val ? TONE_GLIDE_RANGE / val : 0, val >= 0);
+		HANDLE_VALUE(Config_Lead,      UBX_lead,         val, val >= 0 && val <= PREDICT_MAX_LEAD);
 		HANDLE_VALUE(Config_Mode_2,    UBX_mode_2,       val, (val >= 0 && val <= 4) || (val >= 8 && val <= 9) || (val == 11));
 		HANDLE_VALUE(Config_Min_Val_2, UBX_min_2,        val, TRUE);
 		HANDLE_VALUE(Config_Max_Val_2, UBX_max_2,        val, TRUE);
@@ -325,6 +360,12 @@ static FRESULT Config_ReadSingle(
 		HANDLE_VALUE(Config_Window_Below, UBX_alarm_window_below, val * 1000, TRUE);
 		HANDLE_VALUE(Config_DZ_Elev,   UBX_dz_elev,      val * 1000, TRUE);
 		HANDLE_VALUE(Config_TZ_Offset, Log_tz_offset,    val, TRUE);
+		HANDLE_VALUE(Config_Log_Track, Log_track,        val, val >= 0 && val <= 2);
+		HANDLE_VALUE(Config_Log_Raw,   Log_enable_raw,   val, val == 0 || val == 1);
+		HANDLE_VALUE(Config_Log_Len,   Log_max_len,      val, val >= 0 && val <= 600);
+		HANDLE_VALUE(Config_Sync_Rows, UBX_sync_rows,    val, val >= 1 && val <= 255);
+		HANDLE_VALUE(Config_Sync_Int,  UBX_sync_int,     val, val >= 0 && val <= 60000);
+		HANDLE_VALUE(Config_Sync_Phase, UBX_sync_phase,  val, val == 0 || val == 1);
 		HANDLE_VALUE(Config_Init_Mode, UBX_init_mode,    val, val >= 0 && val <= 2);
 		HANDLE_VALUE(Config_Alt_Units, UBX_alt_units,    val, val >= 0 && val <= 1);
 		HANDLE_VALUE(Config_Alt_Step,  UBX_alt_step,     val, val >= 0);
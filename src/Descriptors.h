@@ -45,6 +45,13 @@
 
 	/* Enable/disable serial interface: */
 		// #define USE_SERIAL_INTERFACE
+
+	/* Send decoded epochs over the serial interface instead of raw UBX: */
+		// #define USE_TELEMETRY_INTERFACE
+
+#if defined(USE_TELEMETRY_INTERFACE) && !defined(USE_SERIAL_INTERFACE)
+		#define USE_SERIAL_INTERFACE
+#endif
 		
 	/* Macros: */
 #ifdef USE_SERIAL_INTERFACE
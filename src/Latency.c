@@ -0,0 +1,175 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper                                         **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#include <string.h>
+#include <util/atomic.h>
+
+#include "Latency.h"
+#include "UBX.h"
+
+#ifdef LATENCY_STATS
+
+// Timestamps are the low 16 bits of the millisecond uptime counter, so
+// every stage must take less than 65 s.
+
+#define LATENCY_GPS_WINDOW 10000 // GPS stage floor window (ms)
+
+static Latency_stat_t Latency_stats[LATENCY_STAGES];
+
+static uint16_t Latency_gps_floor[2]; // Smallest offset in the previous and current window
+static uint16_t Latency_gps_window;   // Current window (iTOW / LATENCY_GPS_WINDOW)
+static uint16_t Latency_tone_rx;   // First byte of the epoch behind the tone
+static uint16_t Latency_tone_time; // Last call to UBX_SetTone
+static uint16_t Latency_beep_rx;   // First byte of the epoch behind the beep
+static uint16_t Latency_beep_time; // Start of the beep
+static uint8_t  Latency_armed = 0; // Waiting for the first sample of a beep
+
+static void Latency_Add(
+	uint8_t  stage,
+	uint16_t ms)
+{
+	Latency_stat_t *stat = &Latency_stats[stage];
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (stat->count < UINT16_MAX)
+		{
+			if (stat->count == 0 || ms < stat->min) stat->min = ms;
+			if (stat->count == 0 || ms > stat->max) stat->max = ms;
+
+			stat->sum += ms;
+			++stat->count;
+		}
+	}
+}
+
+uint16_t Latency_Now(void)
+{
+	uint16_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = UBX_stats.upTime;
+	}
+
+	return now;
+}
+
+void Latency_Tone(
+	uint32_t iTOW,
+	uint16_t rxTime,
+	uint16_t commitTime)
+{
+	uint16_t now = Latency_Now();
+	uint16_t offset = rxTime - (uint16_t) iTOW;
+	uint16_t window = iTOW / LATENCY_GPS_WINDOW;
+	uint16_t base;
+
+	// The receiver and uptime clocks have an unknown offset, so only the
+	// variation in this stage means anything. The uptime clock also drifts
+	// against GPS time by the crystal error, up to about 50 ppm. Measuring
+	// from the smallest offset of the last 10-20 s, rather than of the
+	// whole log, keeps that drift under 1 ms.
+
+	if (Latency_stats[LATENCY_GPS].count == 0 || window != Latency_gps_window)
+	{
+		if (Latency_stats[LATENCY_GPS].count == 0 || window != Latency_gps_window + 1)
+		{
+			Latency_gps_floor[1] = offset;
+		}
+
+		Latency_gps_floor[0] = Latency_gps_floor[1];
+		Latency_gps_floor[1] = offset;
+		Latency_gps_window = window;
+	}
+	else if ((int16_t) (offset - Latency_gps_floor[1]) < 0)
+	{
+		Latency_gps_floor[1] = offset;
+	}
+
+	base = Latency_gps_floor[1];
+	if ((int16_t) (Latency_gps_floor[0] - base) < 0)
+	{
+		base = Latency_gps_floor[0];
+	}
+
+	Latency_Add(LATENCY_GPS,  offset - base);
+	Latency_Add(LATENCY_RX,   commitTime - rxTime);
+	Latency_Add(LATENCY_PROC, now - commitTime);
+
+	Latency_tone_rx   = rxTime;
+	Latency_tone_time = now;
+}
+
+void Latency_Beep(void)
+{
+	uint16_t now = Latency_Now();
+
+	Latency_Add(LATENCY_BEEP, now - Latency_tone_time);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Latency_beep_rx   = Latency_tone_rx;
+		Latency_beep_time = now;
+		Latency_armed     = 1;
+	}
+}
+
+void Latency_Output(void)
+{
+	uint16_t now;
+
+	if (!Latency_armed) return;
+
+	now = Latency_Now();
+
+	Latency_Add(LATENCY_OUT,   now - Latency_beep_time);
+	Latency_Add(LATENCY_TOTAL, now - Latency_beep_rx);
+
+	Latency_armed = 0;
+}
+
+void Latency_GetStats(
+	Latency_stat_t *stats)
+{
+	uint8_t i;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (i = 0; i < LATENCY_STAGES; ++i)
+		{
+			stats[i] = Latency_stats[i];
+		}
+	}
+}
+
+void Latency_Reset(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset(Latency_stats, 0, sizeof(Latency_stats));
+		Latency_armed = 0;
+	}
+}
+
+#endif
@@ -0,0 +1,63 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper                                         **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef MGC_LATENCY_H
+#define MGC_LATENCY_H
+
+#include <stdint.h>
+
+// Uncomment to time each stage between a GPS epoch and the first PWM sample
+// of the beep it drives. Results are added to the stats file next to the
+// track, and cover the time since the track was opened. This costs 109 
+// bytes of static RAM: 60 for the stats, 4 in each of the 8 saved UBX 
+// records and 17 of state. Writing the stats row also takes another 60 
+// bytes of stack.
+// #define LATENCY_STATS
+
+#define LATENCY_GPS    0  // iTOW to first byte, above the smallest in 10-20 s
+#define LATENCY_RX     1  // First byte to epoch commit
+#define LATENCY_PROC   2  // Epoch commit to UBX_SetTone
+#define LATENCY_BEEP   3  // UBX_SetTone to beep start
+#define LATENCY_OUT    4  // Beep start to first PWM sample
+#define LATENCY_TOTAL  5  // First byte to first PWM sample
+#define LATENCY_STAGES 6
+
+typedef struct
+{
+	uint16_t min;      // Shortest time                 (ms)
+	uint16_t max;      // Longest time                  (ms)
+	uint32_t sum;      // Total time                    (ms)
+	uint16_t count;    // Number of samples
+}
+Latency_stat_t;
+
+uint16_t Latency_Now(void);
+
+void Latency_Tone(uint32_t iTOW, uint16_t rxTime, uint16_t commitTime);
+void Latency_Beep(void);
+void Latency_Output(void);
+
+void Latency_GetStats(Latency_stat_t *stats);
+void Latency_Reset(void);
+
+#endif
@@ -28,7 +28,6 @@
 
 #include "../../vendor/FatFS/diskio.h"
 #include "../../vendor/FatFS/ff.h"
-#include "Main.h"
 #include "MMC.h"
 
 #define GREEN_LED_DDR  DDRC
@@ -75,7 +74,7 @@ uint8_t MMC_Init(void)
 	}
 }
 
-void MMC_WriteBlocks(
+bool MMC_WriteBlocks(
 	USB_ClassInfo_MS_Device_t *MSInterfaceInfo, 
 	uint32_t                  BlockAddress, 
 	uint16_t                  TotalBlocks)
@@ -83,13 +82,24 @@ void MMC_WriteBlocks(
 	uint8_t  CurrDFPageByteDiv16 = 0;
 
 	/* Wait until endpoint is ready before continuing */
-	if (Endpoint_WaitUntilReady()) return;
+	if (Endpoint_WaitUntilReady()) return false;
+
+	/* Write all sectors with one multiple block command. Each byte goes 
+	   straight from the endpoint to the card, while the host fills the 
+	   other endpoint bank. */
+	if (disk_wstream_start(0, BlockAddress, TotalBlocks) != RES_OK) return false;
 
 	while (TotalBlocks)
 	{
 		uint8_t BytesInBlockDiv16 = 0;
-		uint8_t *buf = Main_buffer;
 		
+		/* Start the next sector */
+		if (!disk_wstream_block())
+		{
+			disk_wstream_stop();
+			return false;
+		}
+
 		/* Write an endpoint packet sized data block to the dataflash */
 		while (BytesInBlockDiv16 < (VIRTUAL_MEMORY_BLOCK_SIZE >> 4))
 		{
@@ -100,26 +110,30 @@ void MMC_WriteBlocks(
 				Endpoint_ClearOUT();
 				
 				/* Wait until the host has sent another packet */
-				if (Endpoint_WaitUntilReady()) return;
+				if (Endpoint_WaitUntilReady())
+				{
+					disk_wstream_stop();
+					return false;
+				}
 			}
 
 			/* Write one 16-byte chunk of data to the dataflash */
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
-			*(buf++) = Endpoint_Read_8();
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
+			disk_wstream_byte(Endpoint_Read_8());
 			
 			/* Increment the dataflash page 16 byte block counter */
 			CurrDFPageByteDiv16++;
@@ -128,27 +142,36 @@ void MMC_WriteBlocks(
 			BytesInBlockDiv16++;
 
 			/* Check if the current command is being aborted by the host */
-			if (MSInterfaceInfo->State.IsMassStoreReset) return;			
+			if (MSInterfaceInfo->State.IsMassStoreReset)
+			{
+				disk_wstream_stop();
+				return false;
+			}
 		}
 
-		/* Write a single sector */
-		disk_write(0, Main_buffer, BlockAddress, 1);
-			
-		/* Increment the block address */
-		BlockAddress++;
+		/* Finish the sector, and give up if the card rejected it */
+		if (!disk_wstream_end())
+		{
+			disk_wstream_stop();
+			return false;
+		}
 			
 		/* Decrement the blocks remaining counter and reset the sub block counter */
 		TotalBlocks--;
 	}
 
+	disk_wstream_stop();
+
 	/* If the endpoint is empty, clear it ready for the next packet from the host */
 	if (!(Endpoint_IsReadWriteAllowed()))
 	{
 		Endpoint_ClearOUT();
 	}
+
+	return true;
 }
 
-void MMC_ReadBlocks(
+bool MMC_ReadBlocks(
 	USB_ClassInfo_MS_Device_t *MSInterfaceInfo, 
 	uint32_t                  BlockAddress, 
 	uint16_t                  TotalBlocks)
@@ -156,18 +179,22 @@ void MMC_ReadBlocks(
 	uint8_t  CurrDFPageByteDiv16 = 0;
 
 	/* Wait until endpoint is ready before continuing */
-	if (Endpoint_WaitUntilReady()) return;
+	if (Endpoint_WaitUntilReady()) return false;
 	
+	/* Read all sectors with one multiple block command, forwarding each 
+	   byte from the card straight to the endpoint */
+	if (disk_stream_start(0, BlockAddress) != RES_OK) return false;
+
 	while (TotalBlocks)
 	{
 		uint8_t BytesInBlockDiv16 = 0;
-		uint8_t *buf = Main_buffer;
 		
-		/* read a single sector */
-		disk_read(0, Main_buffer, BlockAddress, 1);
-			
-		/* Increment the block address */
-		BlockAddress++;
+		/* Wait for the next sector */
+		if (!disk_stream_block())
+		{
+			disk_stream_stop();
+			return false;
+		}
 			
 		/* Write an endpoint packet sized data block to the dataflash */
 		while (BytesInBlockDiv16 < (VIRTUAL_MEMORY_BLOCK_SIZE >> 4))
@@ -179,26 +206,30 @@ void MMC_ReadBlocks(
 				Endpoint_ClearIN();
 				
 				/* Wait until the endpoint is ready for more data */
-				if (Endpoint_WaitUntilReady()) return;
+				if (Endpoint_WaitUntilReady())
+				{
+					disk_stream_stop();
+					return false;
+				}
 			}
 
 			/* Read one 16-byte chunk of data from the dataflash */
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
-			Endpoint_Write_8(*(buf++));
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
+			Endpoint_Write_8(disk_stream_byte());
 			
 			/* Increment the dataflash page 16 byte block counter */
 			CurrDFPageByteDiv16++;
@@ -207,18 +238,26 @@ void MMC_ReadBlocks(
 			BytesInBlockDiv16++;
 
 			/* Check if the current command is being aborted by the host */
-			if (MSInterfaceInfo->State.IsMassStoreReset) return;
+			if (MSInterfaceInfo->State.IsMassStoreReset)
+			{
+				disk_stream_stop();
+				return false;
+			}
 		}
 		
 		/* Decrement the blocks remaining counter */
 		TotalBlocks--;
 	}
 	
+	disk_stream_stop();
+
 	/* If the endpoint is full, send its contents to the host */
 	if (!(Endpoint_IsReadWriteAllowed()))
 	{
 		Endpoint_ClearIN();
 	}
+
+	return true;
 }
 
 bool MMC_CheckDataflashOperation(void)
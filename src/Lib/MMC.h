@@ -31,12 +31,14 @@
 
 uint8_t MMC_Init(void);
 
-void MMC_WriteBlocks(
+// Both return false if the transfer stopped before all of the requested
+// blocks were moved, so that the command can be failed.
+bool MMC_WriteBlocks(
 	USB_ClassInfo_MS_Device_t * const MSInterfaceInfo, 
 	const uint32_t                    BlockAddress,
 	uint16_t                          TotalBlocks);
 	
-void MMC_ReadBlocks(
+bool MMC_ReadBlocks(
 	USB_ClassInfo_MS_Device_t * const MSInterfaceInfo, 
 	const uint32_t                    BlockAddress,
 	uint16_t                          TotalBlocks);
@@ -279,6 +279,7 @@ static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t* const MSInterfa
 {
 	uint32_t BlockAddress;
 	uint16_t TotalBlocks;
+	bool     Success;
 
 	/* Check if the disk is write protected or not */
 	if ((IsDataRead == DATA_WRITE) && DISK_READ_ONLY)
@@ -315,9 +316,20 @@ static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t* const MSInterfa
 
 	/* Determine if the packet is a READ (10) or WRITE (10) command, call appropriate function */
 	if (IsDataRead == DATA_READ)
-	  MMC_ReadBlocks(MSInterfaceInfo, BlockAddress, TotalBlocks);
+	  Success = MMC_ReadBlocks(MSInterfaceInfo, BlockAddress, TotalBlocks);
 	else
-	  MMC_WriteBlocks(MSInterfaceInfo, BlockAddress, TotalBlocks);
+	  Success = MMC_WriteBlocks(MSInterfaceInfo, BlockAddress, TotalBlocks);
+
+	/* Fail the command if the transfer stopped early. The class driver then stalls
+	   the data endpoint, rather than leaving the host waiting for the rest. */
+	if (!Success)
+	{
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+		               SCSI_ASENSE_NO_ADDITIONAL_INFORMATION,
+		               SCSI_ASENSEQ_NO_QUALIFIER);
+
+		return false;
+	}
 
 	/* Update the bytes transferred counter and succeed the command */
 	MSInterfaceInfo->State.CommandBlock.DataTransferLength -= ((uint32_t)TotalBlocks * VIRTUAL_MEMORY_BLOCK_SIZE);
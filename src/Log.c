@@ -21,10 +21,10 @@
 **  Website: http://flysight.ca/                                          **
 ****************************************************************************/
 
+#include <avr/eeprom.h>
 #include <avr/pgmspace.h>
 
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include "Board/LEDs.h"
@@ -33,31 +33,107 @@
 #include "Main.h"
 #include "Power.h"
 #include "Time.h"
+#include "Track.h"
+#include "UBX.h"
 
 #define FILE_NUMBER_ADDR 0
 
+#define MIN(a,b) (((a) < (b)) ?  (a) : (b))
+
+#define LOG_SECTOR_LEN   512          // Card sector (bytes)
+#define LOG_STAGE_LEN    MAIN_LOG_LEN // Track data written in one call (bytes)
+
+#define LOG_CSV_ROW_LEN  160 // Typical CSV row (bytes)
+#define LOG_TRK_ROW_LEN  (sizeof(Track_record_t) + 8) // With room for key records
+
+uint8_t  Log_enable_raw = 0;
+uint8_t  Log_track      = LOG_TRACK_CSV;
+uint16_t Log_max_len    = 30;
 int32_t Log_tz_offset = 0;
 
+FIL     Log_raw_file;
+FIL     Log_stats_file;
+
 static uint8_t Log_initialized = 0;
 static DWORD   Log_fattime;
+static uint8_t Log_stats_initialized = 0;
+
+static uint16_t Log_stage_len = 0;
 
 DWORD get_fattime(void)
 {
 	return Log_fattime;
 }
 
+void Log_Drain(void)
+{
+	UINT bw;
+
+	if (Log_stage_len)
+	{
+		f_write(&Main_file, MAIN_LOG_BUFFER, Log_stage_len, &bw);
+		Log_stage_len = 0;
+	}
+}
+
 void Log_Flush(void)
 {
-	if (Log_initialized)
+	if (Log_initialized && Log_track != LOG_TRACK_NONE)
 	{
+		Log_Drain();
 		f_sync(&Main_file);
 	}
 }
 
+void Log_Write(
+	const void *buf,
+	uint16_t   len)
+{
+	const uint8_t *src = buf;
+	uint16_t n;
+	UINT bw;
+
+	// Track data is staged until the stage holds a whole sector, and then
+	// written in one call. The stage only starts on a sector boundary in
+	// the file, so that the sector goes from the stage to the card without
+	// passing through the file system window. The card driver keeps its
+	// multi-block write open, so each sector continues the last one until
+	// the next sync. While the raw ring is using the log buffer, data goes
+	// straight to the file.
+
+	while (len)
+	{
+		if (Log_enable_raw)
+		{
+			n = len;
+			f_write(&Main_file, src, n, &bw);
+		}
+		else if (!Log_stage_len && Main_file.fptr % LOG_SECTOR_LEN)
+		{
+			n = MIN(len, LOG_SECTOR_LEN - Main_file.fptr % LOG_SECTOR_LEN);
+			f_write(&Main_file, src, n, &bw);
+		}
+		else
+		{
+			n = MIN(len, LOG_STAGE_LEN - Log_stage_len);
+			memcpy(MAIN_LOG_BUFFER + Log_stage_len, src, n);
+
+			Log_stage_len += n;
+			if (Log_stage_len == LOG_STAGE_LEN)
+			{
+				Log_Drain();
+			}
+		}
+
+		src += n;
+		len -= n;
+	}
+}
+
 void Log_WriteChar(
 	char ch)
 {
-    f_putc(ch, &Main_file);
+	Log_Write(&ch, 1);
 }
 
 void Log_WriteString(
@@ -67,40 +143,39 @@ void Log_WriteString(
 
 	while ((ch = pgm_read_byte(str++)))
 	{
-		f_putc(ch, &Main_file);
+		Log_Write(&ch, 1);
 	}
 }
 
-char *Log_WriteInt32ToBuf(
-	char    *ptr, 
-	int32_t val, 
-	int8_t  dec, 
-	int8_t  dot, 
-	char    delimiter)
+void Log_WriteStats(
+	const char *header,
+	const char *values)
 {
-    int32_t value = val > 0 ? val : -val;
-
-    *--ptr = delimiter;
-    while (value > 0 || dec > 0)
-    {
-        ldiv_t res = ldiv(value, 10);
-        *--ptr = res.rem + '0';
-        value = res.quot;
-        if (--dec == 0 && dot)
-        {
-            *--ptr = '.';
-        }
-    }
-    if (*ptr == '.' || *ptr == delimiter)
-    {
-        *--ptr = '0';
-    }
-    if (val < 0)
-    {
-        *--ptr = '-';
-    }
-	
-	return ptr;
+	char ch;
+
+	if (!Log_stats_initialized) return;
+
+	// The header goes in front of the first row only. Rows are appended
+	// and saved to the card with the track, so they add no syncs.
+
+	if (Log_stats_file.fsize == 0)
+	{
+		while ((ch = pgm_read_byte(header++)))
+		{
+			f_putc(ch, &Log_stats_file);
+		}
+	}
+
+	f_puts(values, &Log_stats_file);
+}
+
+void Log_WriteRaw(
+	const uint8_t *buf,
+	uint16_t      len)
+{
+	UINT bw;
+
+	f_write(&Log_raw_file, buf, len, &bw);
 }
 
 static void Log_ToDate(
@@ -120,6 +195,57 @@ static void Log_ToDate(
     name[8] = 0;
 }
 
+static void Log_Allocate(
+	const char *path)
+{
+	uint32_t rows, len;
+	DWORD    ncl;
+
+	if (!Log_max_len) return;
+
+	// Reserve a contiguous run for the longest expected jump, so that 
+	// appending never has to search the FAT. On a fragmented card, the 
+	// longest run found in one bounded pass over the FAT is used.
+
+	rows = (uint32_t) Log_max_len * 60000 / UBX_rate;
+	len  = rows * (Log_track == LOG_TRACK_CSV ? LOG_CSV_ROW_LEN : LOG_TRK_ROW_LEN);
+	ncl  = len / ((DWORD) Main_file.fs->csize * 512) + 1;
+
+	// The file name is saved first so that the unused part of the run can
+	// be freed at the next boot if power is lost
+
+	eeprom_write_block(path, LOG_FNAME_ADDR, LOG_FNAME_LEN);
+
+	f_prealloc(&Main_file, ncl);
+
+	f_sync(&Main_file);
+}
+
+void Log_Recover(void)
+{
+	char    path[LOG_FNAME_LEN];
+	FRESULT res;
+
+	// Free the unused part of a log that was open when power was lost
+
+	eeprom_read_block(path, LOG_FNAME_ADDR, LOG_FNAME_LEN);
+	if (path[8] != '\\') return;
+
+	res = f_chdir("\\");
+	res = f_open(&Main_file, path, FA_WRITE | FA_OPEN_EXISTING);
+	if (res == FR_OK)
+	{
+		f_lseek(&Main_file, Main_file.fsize);
+		f_truncate(&Main_file);
+		f_close(&Main_file);
+	}
+
+	if (res == FR_OK || res == FR_NO_FILE || res == FR_NO_PATH)
+	{
+		eeprom_write_byte((uint8_t *) LOG_FNAME_ADDR + 8, 0);
+	}
+}
+
 void Log_Init(
 	uint16_t year,
 	uint8_t  month,
@@ -129,6 +255,7 @@ void Log_Init(
 	uint8_t  sec)
 {
 	char    fname[13];
+	char    path[LOG_FNAME_LEN];
 
 	FRESULT res;
 
@@ -151,6 +278,8 @@ void Log_Init(
     // create folder.
     year = year % 100;
     Log_ToDate(fname, year, month, day);
+	memcpy(path, fname, 8);
+	path[8] = '\\';
 
 	res = f_chdir("\\");
 	res = f_mkdir(fname);
@@ -159,20 +288,63 @@ void Log_Init(
     // create file.
     Log_ToDate(fname, hour, min, sec);
     fname[ 8] = '.';
-    fname[ 9] = 'c';
-    fname[10] = 's';
-    fname[11] = 'v';
     fname[12] = 0;
 
-	res = f_open(&Main_file, fname, FA_WRITE | FA_CREATE_ALWAYS);
-	if (res != FR_OK)
+	if (Log_track == LOG_TRACK_CSV)
+	{
+		fname[ 9] = 'c';
+		fname[10] = 's';
+		fname[11] = 'v';
+	}
+	else
 	{
-		Main_activeLED = LEDS_RED;
-		LEDs_ChangeLEDs(LEDS_ALL_LEDS, Main_activeLED);
-		return ;
+		fname[ 9] = 't';
+		fname[10] = 'r';
+		fname[11] = 'k';
+	}
+
+	if (Log_track != LOG_TRACK_NONE)
+	{
+		res = f_open(&Main_file, fname, FA_WRITE | FA_CREATE_ALWAYS);
+		if (res != FR_OK)
+		{
+			Main_activeLED = LEDS_RED;
+			LEDs_ChangeLEDs(LEDS_ALL_LEDS, Main_activeLED);
+			return ;
+		}
+
+		memcpy(path + 9, fname, 13);
+		Log_Allocate(path);
+	}
+
+	// Raw receiver output is kept next to the track
+	if (Log_enable_raw)
+	{
+		fname[ 9] = 'u';
+		fname[10] = 'b';
+		fname[11] = 'x';
+
+		res = f_open(&Log_raw_file, fname, FA_WRITE | FA_CREATE_ALWAYS);
+		if (res != FR_OK)
+		{
+			Main_activeLED = LEDS_RED;
+			LEDs_ChangeLEDs(LEDS_ALL_LEDS, Main_activeLED);
+			return ;
+		}
 	}
 
 	Log_initialized = 1;
+
+	// Link statistics are kept next to the track
+	fname[ 9] = 't';
+	fname[10] = 'x';
+	fname[11] = 't';
+
+	res = f_open(&Log_stats_file, fname, FA_WRITE | FA_CREATE_ALWAYS);
+	if (res == FR_OK)
+	{
+		Log_stats_initialized = 1;
+	}
 }
 
 uint8_t Log_IsInitialized(void)
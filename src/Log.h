@@ -24,17 +24,37 @@
 #ifndef MGC_LOG_H
 #define MGC_LOG_H
 
-extern uint8_t Log_enable_raw;
-extern uint8_t Log_enable_csv;
+#include <stdint.h>
+
+#include "FatFS/ff.h"
+
+#define LOG_TRACK_NONE 0
+#define LOG_TRACK_CSV  1
+#define LOG_TRACK_BIN  2
+
+#define LOG_FNAME_ADDR ((void *) 0x0F)
+#define LOG_FNAME_LEN  22
+
+extern FIL      Log_raw_file;
+extern FIL      Log_stats_file;
+
+extern uint8_t  Log_enable_raw;
+extern uint8_t  Log_track;
+extern uint16_t Log_max_len;
 extern int32_t Log_tz_offset;
 
+void Log_Drain(void);
 void Log_Flush(void);
+void Log_Write(const void *buf, uint16_t len);
 void Log_WriteChar(char ch);
 void Log_WriteString(const char *str);
+void Log_WriteStats(const char *header, const char *values);
+void Log_WriteRaw(const uint8_t *buf, uint16_t len);
 char *Log_WriteInt32ToBuf(char *ptr, int32_t val, int8_t dec, int8_t dot, char delimiter);
 
 void Log_Init(uint16_t year, uint8_t month, uint8_t day, 
               uint8_t hour, uint8_t min, uint8_t sec);
 uint8_t Log_IsInitialized(void);
+void Log_Recover(void);
 
 #endif
@@ -0,0 +1,124 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#include <stdint.h>
+
+#include "Log.h"
+
+// Divides by 10 using shifts and adds, since a software division costs
+// hundreds of cycles on the AVR. The estimate of the quotient is at most one
+// too small, which is corrected using the remainder.
+
+static uint8_t Log_DivMod10(
+	uint32_t *value)
+{
+	uint32_t n = *value;
+	uint32_t q;
+	uint8_t  r;
+
+	q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q += q >> 16;
+	q >>= 3;
+	r = n - (((q << 2) + q) << 1);
+	if (r > 9)
+	{
+		++q;
+		r -= 10;
+	}
+
+	*value = q;
+	return r;
+}
+
+// Same as above, for values that fit in 16 bits
+
+static uint8_t Log_DivMod10_16(
+	uint16_t *value)
+{
+	uint16_t n = *value;
+	uint16_t q;
+	uint8_t  r;
+
+	q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q >>= 3;
+	r = n - (((q << 2) + q) << 1);
+	if (r > 9)
+	{
+		++q;
+		r -= 10;
+	}
+
+	*value = q;
+	return r;
+}
+
+char *Log_WriteInt32ToBuf(
+	char    *ptr, 
+	int32_t val, 
+	int8_t  dec, 
+	int8_t  dot, 
+	char    delimiter)
+{
+    uint32_t value = val > 0 ? (uint32_t) val : -(uint32_t) val;
+    uint16_t value_16;
+    uint8_t  rem;
+
+    *--ptr = delimiter;
+    while (value > UINT16_MAX)
+    {
+        rem = Log_DivMod10(&value);
+        *--ptr = rem + '0';
+        if (--dec == 0 && dot)
+        {
+            *--ptr = '.';
+        }
+    }
+
+    // Most values fit in 16 bits after a few digits, and the narrower
+    // arithmetic is much cheaper on the AVR
+
+    value_16 = value;
+    while (value_16 > 0 || dec > 0)
+    {
+        rem = Log_DivMod10_16(&value_16);
+        *--ptr = rem + '0';
+        if (--dec == 0 && dot)
+        {
+            *--ptr = '.';
+        }
+    }
+    if (*ptr == '.' || *ptr == delimiter)
+    {
+        *--ptr = '0';
+    }
+    if (val < 0)
+    {
+        *--ptr = '-';
+    }
+	
+	return ptr;
+}
@@ -24,6 +24,9 @@
 #include <avr/eeprom.h>
 #include <avr/io.h>
 #include <avr/wdt.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/atomic.h>
 #include <util/delay.h>
 
 #include "Board/LEDs.h"
@@ -198,6 +201,16 @@ static void ReadInitFile(void)
 	Power_Release();
 }
 
+static void ClearLinkStats(void)
+{
+	// Drop errors counted while the baud rate was being probed, but keep
+	// the clocks, which count from power on
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memset((void *) &UBX_stats, 0, offsetof(UBX_stats_t, holdTime));
+	}
+}
+
 int main(void)
 {
 	typedef void (*AppPtr_t) (void);
@@ -227,11 +240,39 @@ int main(void)
 		}
 		
 		uart_init(12);
+
+		if (Main_mmcInitialized)
+		{
+			Log_Recover();
+#ifdef USE_TELEMETRY_INTERFACE
+			Config_Read();
+#endif
+		}
+
+#ifdef USE_TELEMETRY_INTERFACE
+		// Decode the receiver output for the host instead of logging it
+		UBX_telemetry = 1;
+
+		// The receiver is configured one message at a time from the loop
+		// below, so the drive stays up even when it never answers
+		Timer_Init();
+		UBX_InitStart();
+
+		uint8_t configured = 0;
+#endif
 		
 		for (;;)
 		{
 			CHARGE_STATUS_PORT |= CHARGE_STATUS_MASK ;
 			
+#ifdef USE_TELEMETRY_INTERFACE
+			if (!configured && UBX_InitTask())
+			{
+				ClearLinkStats();
+				configured = 1;
+			}
+#endif
+
 			if (Main_mmcInitialized)
 			{
 				USBInterfaceTask();
@@ -272,12 +313,18 @@ int main(void)
 		Power_Hold();
 		Signature_Write();
 		Config_Read();
+		Log_Recover();
 		Power_Release();
 				
 		ReadInitFile();
 		
 		Timer_Init();
 		UBX_Init();
+		ClearLinkStats();
+
+		Power_Hold();
+		Signature_WriteBaudRate(UBX_baud);
+		Power_Release();
 
 		for (;;)
 		{
@@ -28,7 +28,14 @@
 
 #include "FatFS/ff.h"
 
-#define MAIN_BUFFER_SIZE 1024
+// Main_buffer is shared between the tone ring and the log. The log part
+// is either the raw receiver ring or the track stage, never both.
+
+#define MAIN_TONE_LEN    1024 // Tone ring (bytes)
+#define MAIN_LOG_LEN     512  // Raw ring or track stage (bytes)
+#define MAIN_LOG_BUFFER  (Main_buffer + MAIN_TONE_LEN)
+
+#define MAIN_BUFFER_SIZE (MAIN_TONE_LEN + MAIN_LOG_LEN)
 
 extern uint8_t Main_activeLED;
 extern FIL     Main_file;
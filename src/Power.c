@@ -38,3 +38,8 @@ void Power_Release(void)
 	PWR_HOLD_DDR  |=  PWR_HOLD_MASK;
 	PWR_HOLD_PORT &= ~PWR_HOLD_MASK;
 }
+
+uint8_t Power_IsHeld(void)
+{
+	return (PWR_HOLD_PORT & PWR_HOLD_MASK) ? 1 : 0;
+}
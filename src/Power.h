@@ -24,7 +24,10 @@
 #ifndef FLYSIGHT_POWER
 #define FLYSIGHT_POWER
 
-void Power_Hold(void);
-void Power_Release(void);
+#include <stdint.h>
+
+void    Power_Hold(void);
+void    Power_Release(void);
+uint8_t Power_IsHeld(void);
 
 #endif
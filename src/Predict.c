@@ -0,0 +1,63 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+
+#include "Predict.h"
+
+// Extrapolates n samples, newest first, to lead ms past the newest one.
+// age[i] is the age of sample i relative to the newest (ms), so age[0] is
+// 0 and ages must increase up to PREDICT_MAX_AGE.
+//
+// The line passes through the mean of the samples with the slope between
+// the oldest and newest. For evenly spaced samples this is the least
+// squares fit, and it needs a single division.
+
+int32_t Predict_Value(
+	const int32_t  *x,
+	const uint16_t *age,
+	uint8_t         n,
+	uint16_t        lead)
+{
+	int32_t sum = 0, diff;
+	uint16_t span = 0;
+	uint8_t i;
+
+	if (n < 2) return x[0];
+
+	for (i = 0; i < n; ++i)
+	{
+		sum  += x[i];
+		span += age[i];
+	}
+
+	diff = x[0] - x[n - 1];
+	if (diff >  PREDICT_MAX_DIFF) diff =  PREDICT_MAX_DIFF;
+	if (diff < -PREDICT_MAX_DIFF) diff = -PREDICT_MAX_DIFF;
+
+	// With the change clamped, the product stays below 2^31 for any lead
+	// and ages within PREDICT_MAX_LEAD and PREDICT_MAX_AGE
+
+	sum += diff * (int32_t) (n * lead + span) / age[n - 1];
+
+	return sum / n;
+}
@@ -0,0 +1,36 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef MGC_PREDICT_H
+#define MGC_PREDICT_H
+
+#include <stdint.h>
+
+#define PREDICT_LEN      3       // Most samples in one fit
+#define PREDICT_MAX_AGE  2000    // Oldest sample used in a fit (ms)
+#define PREDICT_MAX_LEAD 1000    // Furthest extrapolation (ms)
+#define PREDICT_MAX_DIFF 262144L // Largest change used across a fit
+
+int32_t Predict_Value(const int32_t *x, const uint16_t *age, uint8_t n, uint16_t lead);
+
+#endif
@@ -29,6 +29,7 @@
 #include "FatFS/ff.h"
 #include "Main.h"
 #include "Config.h"
+#include "Log.h"
 #include "Signature.h"
 #include "Version.h"
 
@@ -42,6 +43,14 @@ static const char SignatureFooter[] PROGMEM = "\
 \r\n\
 Firmware version: " FLYSIGHT_VERSION "\r\n";
 
+static const char SignatureBaudRate[] PROGMEM = "\
+GPS baud rate: ";
+
+static const char SignatureSDClock[] PROGMEM = "\
+SD clock (kHz): ";
+
+extern WORD disk_spi_khz;
+
 void Signature_WriteString(const char * string)
 {
     char c;
@@ -57,6 +66,18 @@ void Signature_WriteHexNibble(char nibble)
         f_putc(nibble + '0', &Main_file);
 }
 
+static void Signature_WriteNumber(uint32_t val)
+{
+    char buf[12];
+    char *ptr;
+
+    ptr = buf + sizeof(buf);
+    *(--ptr) = 0;
+    *(--ptr) = '\n';
+    ptr = Log_WriteInt32ToBuf(ptr, val, 0, 0, '\r');
+    f_puts(ptr, &Main_file);
+}
+
 void Signature_Write(void)
 {
     FRESULT res;
@@ -75,6 +96,26 @@ void Signature_Write(void)
     }
 
     Signature_WriteString(SignatureFooter);
+
+    Signature_WriteString(SignatureSDClock);
+    Signature_WriteNumber(disk_spi_khz);
     
     f_close(&Main_file);
 }
+
+void Signature_WriteBaudRate(uint32_t baud)
+{
+    FRESULT res;
+
+    res = f_chdir("\\");
+    res = f_open(&Main_file, "flysight.txt", FA_WRITE | FA_OPEN_ALWAYS);
+    if (res != FR_OK)
+        return;     // ignore failures
+
+    f_lseek(&Main_file, Main_file.fsize);
+
+    Signature_WriteString(SignatureBaudRate);
+    Signature_WriteNumber(baud);
+
+    f_close(&Main_file);
+}
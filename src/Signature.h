@@ -24,6 +24,9 @@
 #ifndef SIGNATURE_H
 #define SIGNATURE_H
 
+#include <stdint.h>
+
 void Signature_Write(void);
+void Signature_WriteBaudRate(uint32_t baud);
 
 #endif // SIGNATURE_H
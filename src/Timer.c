@@ -45,7 +45,7 @@ void Timer_Init(void)
 {
     TCCR3B = (1 << WGM32) | (1 << CS31);
 	TIMSK3 = (1 << OCIE3A);
-	OCR3A = 1000;
+	OCR3A = 999; // CTC period is OCR3A + 1 counts of 1 us
 }
 
 void Timer_Set(
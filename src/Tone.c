@@ -23,25 +23,28 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <avr/pgmspace.h>
 #include <util/atomic.h>
 
 #include "Board/LEDs.h"
 #include "FatFS/ff.h"
+#include "Latency.h"
 #include "Log.h"
 #include "Main.h"
 #include "Power.h"
 #include "Tone.h"
+#include "ToneFill.h"
 
 #define MIN(a,b) (((a) < (b)) ?  (a) : (b))
 #define MAX(a,b) (((a) > (b)) ?  (a) : (b))
 
-#define TONE_BUFFER_LEN   MAIN_BUFFER_SIZE		 // size of circular buffer
+#define TONE_BUFFER_LEN   MAIN_TONE_LEN		 // size of circular buffer
 #define TONE_BUFFER_CHUNK (TONE_BUFFER_LEN / 8)  // maximum bytes read in one operation
 #define TONE_BUFFER_WRITE (TONE_BUFFER_LEN - TONE_BUFFER_CHUNK)  // buffered samples required to allow write/flush
 
 #define TONE_SAMPLE_LEN  4  // number of repeated PWM samples
 
+#define TONE_STEP(index) (((int32_t) (index) * 3242 + 30212096) * TONE_SAMPLE_LEN)
+
 #define TONE_STATE_IDLE  0
 #define TONE_STATE_PLAY  1
 
@@ -52,47 +55,11 @@
 #define TONE_MODE_BEEP   0
 #define TONE_MODE_WAV    1
 
-static const uint8_t Tone_sine_table[] PROGMEM =
-{
-	128, 131, 134, 137, 140, 143, 146, 149,
-	153, 156, 159, 162, 165, 168, 171, 174,
-	177, 180, 182, 185, 188, 191, 194, 196,
-	199, 201, 204, 207, 209, 211, 214, 216,
-	218, 220, 223, 225, 227, 229, 231, 232,
-	234, 236, 238, 239, 241, 242, 243, 245,
-	246, 247, 248, 249, 250, 251, 252, 253,
-	253, 254, 254, 255, 255, 255, 255, 255,
-	255, 255, 255, 255, 255, 254, 254, 253,
-	253, 252, 251, 251, 250, 249, 248, 247,
-	245, 244, 243, 241, 240, 238, 237, 235,
-	233, 232, 230, 228, 226, 224, 222, 219,
-	217, 215, 213, 210, 208, 205, 203, 200,
-	198, 195, 192, 189, 187, 184, 181, 178,
-	175, 172, 169, 166, 163, 160, 157, 154,
-	151, 148, 145, 142, 139, 135, 132, 129,
-	126, 123, 120, 116, 113, 110, 107, 104,
-	 101, 98,  95,  92,  89,  86,  83,  80,
-	 77,  74,  71,  68,  66,  63,  60,  57,
-	 55,  52,  50,  47,  45,  42,  40,  38,
-	 36,  33,  31,  29,  27,  25,  23,  22,
-	 20,  18,  17,  15,  14,  12,  11,  10,
-	  8,   7,   6,   5,   4,   4,   3,   2,
-	  2,   1,   1,   0,   0,   0,   0,   0,
-	  0,   0,   0,   0,   0,   1,   1,   2,
-	  2,   3,   4,   5,   6,   7,   8,   9,
-	 10,  12,  13,  14,  16,  17,  19,  21,
-	 23,  24,  26,  28,  30,  32,  35,  37,
-	 39,  41,  44,  46,  48,  51,  54,  56,
-	 59,  61,  64,  67,  70,  73,  75,  78,
-	 81,  84,  87,  90,  93,  96,  99, 102,
-	106, 109, 112, 115, 118, 121, 124, 128
-};
-
 static volatile uint16_t Tone_read;
 static volatile uint16_t Tone_write;
 
-static          uint32_t Tone_step;
-static          uint32_t Tone_chirp; 
+static ToneFill_osc_t   Tone_osc;
+static ToneFill_scale_t Tone_scale;
 static          uint16_t Tone_len;
 
 static volatile uint8_t  Tone_state = TONE_STATE_IDLE;
@@ -102,6 +69,7 @@ static          FIL      Tone_file;
 
                 uint16_t Tone_volume = 2;
                 uint16_t Tone_sp_volume = 0;
+                uint32_t Tone_glide = 0;
 
 static volatile uint16_t Tone_next_index = 0;
 static volatile uint32_t Tone_next_chirp = 0; 
@@ -114,16 +82,35 @@ static          uint32_t Tone_wav_samples;
 
 extern int disk_is_ready(void);
 
-ISR(TIMER1_OVF_vect)
+// Timer 1 overflows at 31.25 kHz, and a new sample is taken from the
+// buffer on every TONE_SAMPLE_LEN-th overflow. The PWM values in between
+// are linearly interpolated. Tone_Refill computes them once per sample and
+// queues them in GPIOR0..GPIOR2, so the other overflows only shift the queue
+// into OCR1A/OCR1B.
+//
+// With TONE_NAKED_ISR defined, that path is written by hand to save only one
+// register and SREG; the C handler saves every register used by Tone_Refill.
+// The hand-written handler has not yet been built or timed on the target
+// (tools/audiobench runs both), so the C handler is the default.
+
+#if TONE_SAMPLE_LEN != 4
+#error "The PWM queue in GPIOR0..GPIOR2 holds exactly three interpolated values"
+#endif
+
+static uint8_t Tone_tick __attribute__((used)) = 0;  // interpolated values left in queue
+
+__attribute__((used)) static void Tone_Refill(void)
 {
-	static uint8_t i = 0;
-	static uint16_t s1, s2, step;
+	static uint16_t s2;
+	       uint16_t s1, step;
 
-	if (i++ % TONE_SAMPLE_LEN)
-	{
-		s1 += step;
-	}
-	else if (Tone_read == Tone_write)
+	Tone_tick = TONE_SAMPLE_LEN - 1;
+
+#ifdef LATENCY_STATS
+	Latency_Output();
+#endif
+
+	if (Tone_read == Tone_write)
 	{
 		if (Tone_flags & TONE_FLAGS_LOAD)
 		{
@@ -139,6 +126,7 @@ ISR(TIMER1_OVF_vect)
 			TIMSK1 = 0;
 
 			Tone_flags |= TONE_FLAGS_STOP;
+			return;
 		}
 	}
 	else 
@@ -162,9 +150,109 @@ ISR(TIMER1_OVF_vect)
 		++Tone_read;
 	}
 
+	// Writing the 16-bit registers with a zero high byte leaves zero in the
+	// timer's TEMP register, so the fast path below only writes low bytes.
 	OCR1A = OCR1B = s1 >> 8;
+
+	s1 += step;
+	GPIOR0 = s1 >> 8;
+	s1 += step;
+	GPIOR1 = s1 >> 8;
+	s1 += step;
+	GPIOR2 = s1 >> 8;
+}
+
+#ifndef TONE_NAKED_ISR
+
+ISR(TIMER1_OVF_vect)
+{
+	if (Tone_tick == 0)
+	{
+		Tone_Refill();
+	}
+	else
+	{
+		// Output the next interpolated value and shift the queue
+		uint8_t pwm = GPIOR0;
+
+		--Tone_tick;
+		OCR1AL = pwm;
+		OCR1BL = pwm;
+		GPIOR0 = GPIOR1;
+		GPIOR1 = GPIOR2;
+	}
+}
+
+#else
+
+ISR(TIMER1_OVF_vect, ISR_NAKED)
+{
+	asm volatile (
+		"push r24"                 "\n\t"
+		"in   r24, __SREG__"       "\n\t"
+		"push r24"                 "\n\t"
+		"lds  r24, Tone_tick"      "\n\t"
+		"subi r24, 1"              "\n\t"
+		"brcs 1f"                  "\n\t"
+
+		// Output the next interpolated value and shift the queue
+		"sts  Tone_tick, r24"      "\n\t"
+		"in   r24, %[gpior0]"      "\n\t"
+		"sts  %[ocr1al], r24"      "\n\t"
+		"sts  %[ocr1bl], r24"      "\n\t"
+		"in   r24, %[gpior1]"      "\n\t"
+		"out  %[gpior0], r24"      "\n\t"
+		"in   r24, %[gpior2]"      "\n\t"
+		"out  %[gpior1], r24"      "\n\t"
+		"rjmp 2f"                  "\n"
+
+		// Queue empty: save the registers a C function may clobber
+		"1:"                       "\n\t"
+		"push r0"                  "\n\t"
+		"push r1"                  "\n\t"
+		"push r18"                 "\n\t"
+		"push r19"                 "\n\t"
+		"push r20"                 "\n\t"
+		"push r21"                 "\n\t"
+		"push r22"                 "\n\t"
+		"push r23"                 "\n\t"
+		"push r25"                 "\n\t"
+		"push r26"                 "\n\t"
+		"push r27"                 "\n\t"
+		"push r30"                 "\n\t"
+		"push r31"                 "\n\t"
+		"clr  r1"                  "\n\t"
+		"call Tone_Refill"         "\n\t"
+		"pop  r31"                 "\n\t"
+		"pop  r30"                 "\n\t"
+		"pop  r27"                 "\n\t"
+		"pop  r26"                 "\n\t"
+		"pop  r25"                 "\n\t"
+		"pop  r23"                 "\n\t"
+		"pop  r22"                 "\n\t"
+		"pop  r21"                 "\n\t"
+		"pop  r20"                 "\n\t"
+		"pop  r19"                 "\n\t"
+		"pop  r18"                 "\n\t"
+		"pop  r1"                  "\n\t"
+		"pop  r0"                  "\n"
+
+		"2:"                       "\n\t"
+		"pop  r24"                 "\n\t"
+		"out  __SREG__, r24"       "\n\t"
+		"pop  r24"                 "\n\t"
+		"reti"                     "\n\t"
+		:
+		: [gpior0] "I" (_SFR_IO_ADDR(GPIOR0)),
+		  [gpior1] "I" (_SFR_IO_ADDR(GPIOR1)),
+		  [gpior2] "I" (_SFR_IO_ADDR(GPIOR2)),
+		  [ocr1al] "n" (_SFR_MEM_ADDR(OCR1AL)),
+		  [ocr1bl] "n" (_SFR_MEM_ADDR(OCR1BL))
+	);
 }
 
+#endif
+
 void Tone_Init(void)
 {
 	DDRB |= (1 << 6) | (1 << 5);
@@ -211,10 +299,8 @@ void Tone_SetChirp(
 
 static void Tone_LoadTable(void)
 {
-	static uint16_t phase = 0;
-	       uint8_t  val;
-		   uint16_t read;
-	       uint16_t size, i;
+	uint16_t read;
+	uint16_t size, offset, run;
 
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
@@ -223,17 +309,20 @@ static void Tone_LoadTable(void)
 
 	size = read + TONE_BUFFER_LEN - Tone_write;
 	size = MIN(size, Tone_len);
+	Tone_len -= size;
 
-	for (i = 0; i < size; ++i, --Tone_len)
+	if (Tone_osc.slew)
 	{
-		val = pgm_read_byte(&Tone_sine_table[phase >> 8]);
+		// Glide toward the latest pitch from here on
+		Tone_osc.target = TONE_STEP(Tone_next_index);
+	}
 
-		phase += Tone_step >> 16;
-		Tone_step += Tone_chirp;
+	// Fill to the end of the circular buffer, then wrap around
+	offset = Tone_write % TONE_BUFFER_LEN;
+	run = MIN(size, TONE_BUFFER_LEN - offset);
 
-		val = 128 - (128 >> Tone_volume) + (val >> Tone_volume);
-		Main_buffer[(Tone_write + i) % TONE_BUFFER_LEN] = val;
-	}
+	ToneFill_Sine(&Main_buffer[offset], run, &Tone_osc, &Tone_scale);
+	ToneFill_Sine(Main_buffer, size - run, &Tone_osc, &Tone_scale);
 
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
@@ -250,19 +339,14 @@ static void Tone_ReadFile(
 	uint16_t size)
 {
 	UINT     br;
-	uint16_t i;
-	uint8_t  val;
+	uint8_t  *ptr = &Main_buffer[Tone_write % TONE_BUFFER_LEN];
 
+	// Tone_LoadWAV splits reads at the end of the circular buffer
 	size = MIN(size, Tone_wav_samples);
-	f_read(&Tone_file, &Main_buffer[Tone_write % TONE_BUFFER_LEN], size, &br);
+	f_read(&Tone_file, ptr, size, &br);
 	Tone_wav_samples -= br;
 
-	for (i = 0; i < br; ++i)
-	{
-		val = Main_buffer[(Tone_write + i) % TONE_BUFFER_LEN];
-		val = 128 - (128 >> Tone_sp_volume) + (val >> Tone_sp_volume);
-		Main_buffer[(Tone_write + i) % TONE_BUFFER_LEN] = val;
-	}
+	ToneFill_Scale(ptr, br, &Tone_scale);
 
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
@@ -339,6 +423,7 @@ static void Tone_Start(
 		
 		TCNT1 = 255;
 		OCR1A = OCR1B = Main_buffer[0];
+		Tone_tick = 0;
 		
 		TCCR1A = (1 << COM1A1) | (1 << COM1A0) | (1 << COM1B1) | (1 << WGM10);
 		TCCR1B = (1 << WGM12) | (1 << CS10);
@@ -373,13 +458,44 @@ void Tone_Stop(void)
 	}
 }
 
+static void Tone_StartBeep(
+	uint16_t index,
+	uint32_t chirp,
+	uint16_t len,
+	uint32_t slew)
+{
+	if (Tone_volume < 8)
+	{
+		Tone_Stop();
+		
+		Tone_osc.step   = TONE_STEP(index);
+		Tone_osc.chirp  = chirp * TONE_SAMPLE_LEN * TONE_SAMPLE_LEN;
+		Tone_osc.target = Tone_osc.step;
+		Tone_osc.slew   = slew;
+		Tone_len        = len / TONE_SAMPLE_LEN;
+
+		ToneFill_SetScale(&Tone_scale, Tone_volume);
+		
+		Tone_Start(TONE_MODE_BEEP);
+	}
+}
+
 void Tone_Task(void)
 {
 	if (Tone_flags & TONE_FLAGS_BEEP)
 	{
 		if (Tone_state == TONE_STATE_IDLE)
 		{
-			Tone_Beep(Tone_next_index, Tone_next_chirp, TONE_LENGTH_125_MS);
+			// Chirps mark the pitch limits, so only steady beeps glide
+			Tone_StartBeep(Tone_next_index, Tone_next_chirp, TONE_LENGTH_125_MS,
+				Tone_next_chirp ? 0 : Tone_glide);
+
+#ifdef LATENCY_STATS
+			if (Tone_state != TONE_STATE_IDLE)
+			{
+				Latency_Beep();
+			}
+#endif
 		}
 
 		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
@@ -404,16 +520,7 @@ void Tone_Beep(
 	uint32_t chirp,
 	uint16_t len)
 {
-	if (Tone_volume < 8)
-	{
-		Tone_Stop();
-		
-		Tone_step  = ((int32_t) index * 3242 + 30212096) * TONE_SAMPLE_LEN;
-		Tone_chirp = chirp * TONE_SAMPLE_LEN * TONE_SAMPLE_LEN;
-		Tone_len   = len / TONE_SAMPLE_LEN;
-		
-		Tone_Start(TONE_MODE_BEEP);
-	}
+	Tone_StartBeep(index, chirp, len, 0);
 }
 
 void Tone_Play(
@@ -425,6 +532,8 @@ void Tone_Play(
 	{
 		Tone_Stop();
 
+		ToneFill_SetScale(&Tone_scale, Tone_sp_volume);
+
 		f_chdir("\\audio");
 
 		if (f_open(&Tone_file, filename, FA_READ) == FR_OK)
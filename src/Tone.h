@@ -34,8 +34,12 @@
 
 #define TONE_CHIRP_MAX     (((uint32_t) 3242 << 16) / TONE_LENGTH_125_MS)
 
+// Tone_glide for a glide across the full pitch range in 1 ms
+#define TONE_GLIDE_RANGE   ((uint32_t) TONE_MAX_PITCH * 3242 / 125 * 64)
+
 extern uint16_t Tone_volume;
 extern uint16_t Tone_sp_volume;
+extern uint32_t Tone_glide;
 
 void Tone_Init(void);
 void Tone_Update(void);
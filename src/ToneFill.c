@@ -0,0 +1,174 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#include <avr/pgmspace.h>
+
+#include "ToneFill.h"
+
+// The sample generators below run in the main loop for every sample played,
+// so all per-sample state is kept in locals. Writes through a uint8_t pointer
+// may alias anything, which would otherwise force the oscillator state to be
+// reloaded and stored on every sample.
+
+static const uint8_t ToneFill_sine_table[] PROGMEM =
+{
+	128, 131, 134, 137, 140, 143, 146, 149,
+	153, 156, 159, 162, 165, 168, 171, 174,
+	177, 180, 182, 185, 188, 191, 194, 196,
+	199, 201, 204, 207, 209, 211, 214, 216,
+	218, 220, 223, 225, 227, 229, 231, 232,
+	234, 236, 238, 239, 241, 242, 243, 245,
+	246, 247, 248, 249, 250, 251, 252, 253,
+	253, 254, 254, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 254, 254, 253,
+	253, 252, 251, 251, 250, 249, 248, 247,
+	245, 244, 243, 241, 240, 238, 237, 235,
+	233, 232, 230, 228, 226, 224, 222, 219,
+	217, 215, 213, 210, 208, 205, 203, 200,
+	198, 195, 192, 189, 187, 184, 181, 178,
+	175, 172, 169, 166, 163, 160, 157, 154,
+	151, 148, 145, 142, 139, 135, 132, 129,
+	126, 123, 120, 116, 113, 110, 107, 104,
+	 101, 98,  95,  92,  89,  86,  83,  80,
+	 77,  74,  71,  68,  66,  63,  60,  57,
+	 55,  52,  50,  47,  45,  42,  40,  38,
+	 36,  33,  31,  29,  27,  25,  23,  22,
+	 20,  18,  17,  15,  14,  12,  11,  10,
+	  8,   7,   6,   5,   4,   4,   3,   2,
+	  2,   1,   1,   0,   0,   0,   0,   0,
+	  0,   0,   0,   0,   0,   1,   1,   2,
+	  2,   3,   4,   5,   6,   7,   8,   9,
+	 10,  12,  13,  14,  16,  17,  19,  21,
+	 23,  24,  26,  28,  30,  32,  35,  37,
+	 39,  41,  44,  46,  48,  51,  54,  56,
+	 59,  61,  64,  67,  70,  73,  75,  78,
+	 81,  84,  87,  90,  93,  96,  99, 102,
+	106, 109, 112, 115, 118, 121, 124, 128
+};
+
+// Volume v scales samples by 2^-v about the midpoint, i.e.
+// 128 - (128 >> v) + (val >> v). For v > 0, val >> v equals the high byte
+// of val * (256 >> v), which is a single hardware multiply instead of a
+// variable shift loop.
+
+void ToneFill_SetScale(
+	ToneFill_scale_t *scale,
+	uint8_t          volume)
+{
+	if (volume == 0)
+	{
+		scale->gain   = 0;
+		scale->offset = 0;
+	}
+	else
+	{
+		scale->gain   = 256 >> volume;
+		scale->offset = 128 - (128 >> volume);
+	}
+}
+
+void ToneFill_Sine(
+	uint8_t                *dst,
+	uint16_t               len,
+	ToneFill_osc_t         *osc,
+	const ToneFill_scale_t *scale)
+{
+	uint16_t phase  = osc->phase;
+	uint32_t step   = osc->step;
+	uint32_t chirp  = osc->chirp;
+	uint32_t target = osc->target;
+	uint32_t slew   = osc->slew;
+	uint8_t  gain   = scale->gain;
+	uint8_t  offset = scale->offset;
+	uint8_t  val;
+
+	if (slew)
+	{
+		// Glide toward the target step, by at most slew per sample
+		while (len--)
+		{
+			val = pgm_read_byte(&ToneFill_sine_table[phase >> 8]);
+
+			phase += step >> 16;
+
+			if (step < target)
+			{
+				step = (target - step > slew) ? step + slew : target;
+			}
+			else
+			{
+				step = (step - target > slew) ? step - slew : target;
+			}
+
+			if (gain)
+			{
+				val = offset + (((uint16_t) val * gain) >> 8);
+			}
+
+			*dst++ = val;
+		}
+	}
+	else if (gain)
+	{
+		while (len--)
+		{
+			val = pgm_read_byte(&ToneFill_sine_table[phase >> 8]);
+
+			phase += step >> 16;
+			step += chirp;
+
+			*dst++ = offset + (((uint16_t) val * gain) >> 8);
+		}
+	}
+	else
+	{
+		while (len--)
+		{
+			*dst++ = pgm_read_byte(&ToneFill_sine_table[phase >> 8]);
+
+			phase += step >> 16;
+			step += chirp;
+		}
+	}
+
+	osc->phase = phase;
+	osc->step  = step;
+}
+
+void ToneFill_Scale(
+	uint8_t                *dst,
+	uint16_t               len,
+	const ToneFill_scale_t *scale)
+{
+	uint8_t gain   = scale->gain;
+	uint8_t offset = scale->offset;
+
+	if (gain)
+	{
+		while (len--)
+		{
+			*dst = offset + (((uint16_t) *dst * gain) >> 8);
+			++dst;
+		}
+	}
+}
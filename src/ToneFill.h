@@ -0,0 +1,51 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef MGC_TONEFILL_H
+#define MGC_TONEFILL_H
+
+#include <stdint.h>
+
+typedef struct
+{
+	uint8_t  gain;   // Sample scale (1/256), or 0 to leave samples unscaled
+	uint8_t  offset; // Added after scaling to keep samples centred on 128
+}
+ToneFill_scale_t;
+
+typedef struct
+{
+	uint16_t phase;  // Sine table position (1/256 entry)
+	uint32_t step;   // Phase increment per sample (1/65536 phase)
+	uint32_t chirp;  // Step increment per sample
+	uint32_t target; // Step to glide toward
+	uint32_t slew;   // Largest step change per sample, or 0 to chirp instead
+}
+ToneFill_osc_t;
+
+void ToneFill_SetScale(ToneFill_scale_t *scale, uint8_t volume);
+
+void ToneFill_Sine(uint8_t *dst, uint16_t len, ToneFill_osc_t *osc, const ToneFill_scale_t *scale);
+void ToneFill_Scale(uint8_t *dst, uint16_t len, const ToneFill_scale_t *scale);
+
+#endif
@@ -0,0 +1,123 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef FLYSIGHT_TRACK_H
+#define FLYSIGHT_TRACK_H
+
+#include <stdint.h>
+
+// Binary track (.trk) format. The file starts with a Track_header_t, 
+// followed by the firmware version as a null-terminated string, followed by
+// fixed-size records. All values are little-endian.
+
+#define TRACK_MAGIC        "FSTK"
+#define TRACK_VERSION      1
+
+#define TRACK_POS          0x01 // Position fields are valid
+#define TRACK_SOL          0x02 // gpsFix and numSV are valid
+#define TRACK_VEL          0x04 // Velocity fields are valid
+#define TRACK_TIME         0x08 // Time fields are valid
+#define TRACK_KEY          0x80 // Record is a Track_key_t
+
+// Unlike the CSV track, the binary track is lossy. Heading is rounded to 
+// 0.01 deg, and each accuracy is rounded to the nearest step and stored in
+// one byte that saturates at 255 steps:
+//
+//   hAcc, vAcc  0.1 m steps,    up to 25.5 m
+//   sAcc        0.01 m/s steps, up to 2.55 m/s
+//   cAcc        0.1 deg steps,  up to 25.5 deg
+//
+// A saturated accuracy only means "at least" that much. trk2csv writes it
+// as the cap.
+
+#define TRACK_HACC_SCALE   100   // Horizontal accuracy unit (mm)
+#define TRACK_VACC_SCALE   100   // Vertical accuracy unit   (mm)
+#define TRACK_SACC_SCALE   1     // Speed accuracy unit      (cm/s)
+#define TRACK_HEAD_SCALE   1000  // Heading unit             (deg * 1e-5)
+#define TRACK_CACC_SCALE   10000 // Heading accuracy unit    (deg * 1e-5)
+
+typedef struct __attribute__((packed))
+{
+	char     magic[4];     // TRACK_MAGIC
+	uint8_t  version;      // TRACK_VERSION
+	uint8_t  recordLen;    // Size of each record          (bytes)
+	uint16_t headerLen;    // Size including the version   (bytes)
+
+	uint16_t year;         // UTC time that record times are relative to
+	uint8_t  month;
+	uint8_t  day;
+	uint8_t  hour;
+	uint8_t  min;
+	uint8_t  sec;
+	uint8_t  reserved;
+
+	uint16_t hAccScale;    // TRACK_HACC_SCALE
+	uint16_t vAccScale;    // TRACK_VACC_SCALE
+	uint16_t sAccScale;    // TRACK_SACC_SCALE
+	uint16_t headScale;    // TRACK_HEAD_SCALE
+	uint32_t cAccScale;    // TRACK_CACC_SCALE
+}
+Track_header_t;
+
+// Sets the absolute position that following records are relative to. It is
+// written before the first record, and whenever a change in position does
+// not fit in a record.
+
+typedef struct __attribute__((packed))
+{
+	uint8_t  flags;        // TRACK_KEY
+	uint8_t  reserved_1[3];
+
+	int32_t  lat;          // Latitude                     (deg * 1e-7)
+	int32_t  lon;          // Longitude                    (deg * 1e-7)
+	int32_t  hMSL;         // Height above mean sea level  (mm)
+
+	uint8_t  reserved_2[8];
+}
+Track_key_t;
+
+typedef struct __attribute__((packed))
+{
+	uint8_t  flags;        // TRACK_POS, TRACK_SOL, TRACK_VEL, TRACK_TIME
+	uint8_t  gpsFix;       // GPS fix type
+	uint8_t  numSV;        // Number of SVs in solution
+	int8_t   csec;         // Hundredths of second         (s * 1e-2)
+	uint16_t sec;          // Time since header time, mod 65536 (s)
+
+	int16_t  dLat;         // Change in latitude           (deg * 1e-7)
+	int16_t  dLon;         // Change in longitude          (deg * 1e-7)
+	int16_t  dHMSL;        // Change in height             (mm)
+
+	int16_t  velN;         // North velocity               (cm/s)
+	int16_t  velE;         // East velocity                (cm/s)
+	int16_t  velD;         // Down velocity                (cm/s)
+	uint16_t heading;      // 2D heading                   (headScale)
+
+	uint8_t  hAcc;         // Horizontal accuracy estimate (hAccScale)
+	uint8_t  vAcc;         // Vertical accuracy estimate   (vAccScale)
+	uint8_t  sAcc;         // Speed accuracy estimate      (sAccScale)
+	uint8_t  cAcc;         // Heading accuracy estimate    (cAccScale)
+}
+Track_record_t;
+
+#endif
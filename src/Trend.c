@@ -0,0 +1,172 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+
+#include <avr/pgmspace.h>
+
+#include "Trend.h"
+
+#define ABS(a)   ((a) < 0     ? -(a) : (a))
+#define MIN(a,b) (((a) < (b)) ?  (a) : (b))
+#define MAX(a,b) (((a) > (b)) ?  (a) : (b))
+
+#define TREND_GAIN_MIN  -20     // Tracking index of the first gain (2^(n/2))
+#define TREND_MAX_VALUE 262144L // Largest filtered value    (1/65536 of range)
+#define TREND_MAX_ERROR 65535L  // Largest innovation        (1/65536 of range)
+#define TREND_MAX_STEP  131072L // Largest change per interval (1/65536 of range)
+
+// Steady-state alpha-beta gains (Kalata) for tracking indices from 2^-10
+// to 2^4 in half-octave steps, as alpha and beta * 2^14
+
+static const uint16_t Trend_gains[][2] PROGMEM =
+{
+	{   708,    16 }, {   839,    22 }, {   993,    31 }, {  1174,    44 },
+	{  1386,    61 }, {  1635,    86 }, {  1925,   120 }, {  2263,   168 },
+	{  2654,   234 }, {  3105,   326 }, {  3622,   452 }, {  4210,   624 },
+	{  4874,   858 }, {  5615,  1174 }, {  6434,  1596 }, {  7324,  2154 },
+	{  8276,  2881 }, {  9274,  3816 }, { 10295,  4994 }, { 11311,  6447 },
+	{ 12288,  8192 }, { 13192, 10226 }, { 13994, 12516 }, { 14669, 14994 },
+	{ 15208, 17560 }, { 15614, 20098 }, { 15902, 22488 }, { 16095, 24637 },
+	{ 16217, 26482 }
+};
+
+#define TREND_NUM_GAINS (sizeof(Trend_gains) / sizeof(Trend_gains[0]))
+
+// Returns 2 log2(x) rounded down, taking sqrt(2) as 1.5
+
+static int8_t Trend_Log2x2(
+	uint32_t x)
+{
+	int8_t n = 0;
+
+	while (x >= 4)
+	{
+		x >>= 1;
+		n += 2;
+	}
+
+	// x is now the leading two bits: 2 or 3 add 2 or 3, and 1 (or 0 for
+	// x = 0) adds nothing
+
+	if (x >= 2) n += x;
+
+	return n;
+}
+
+// Sets the range that rates are given as a fraction of, and the nominal
+// time between updates. This only divides when the values change, which
+// is after the configuration is read.
+
+void Trend_Configure(
+	Trend_t  *trend,
+	int32_t  min,
+	int32_t  max,
+	uint16_t interval)
+{
+	uint32_t range;
+
+	if (min == trend->min && max == trend->max && interval == trend->interval) return;
+
+	trend->min      = min;
+	trend->max      = max;
+	trend->interval = interval;
+
+	range = MAX(min, max) - MIN(min, max);
+
+	trend->scale     = range    ? (1UL << 29) / range  : 0;
+	trend->perStep   = interval ? (1UL << 24) / interval : 0;
+	trend->perSecond = interval ? 625000UL / interval  : 0;
+	trend->logSquare = Trend_Log2x2((uint32_t) interval * interval);
+
+	Trend_Reset(trend);
+}
+
+void Trend_Reset(
+	Trend_t *trend)
+{
+	trend->count = 0;
+}
+
+// Filters a new value and returns its rate of change in percent * 100 of
+// the range per second. noise is the speed accuracy estimate (cm/s). The
+// gains balance it against TREND_JERK_LOG2, which is independent of the
+// units of val as long as it is a smooth function of velocity. Returns 0
+// until three values have been filtered since a reset or a gap.
+
+uint8_t Trend_Update(
+	Trend_t  *trend,
+	int32_t  val,
+	uint32_t time,
+	uint32_t noise,
+	int32_t  *rate)
+{
+	int32_t lo = MIN(trend->min, trend->max);
+	int32_t hi = MAX(trend->min, trend->max);
+	int32_t range = hi - lo;
+	uint32_t dt = time - trend->time;
+	int32_t z, x, err;
+	int8_t i;
+
+	if (!trend->scale || !trend->perStep) return 0;
+
+	// Value relative to the range, within one range of either end
+
+	val = MAX(val, lo - range);
+	val = MIN(val, hi + range);
+	z = ((val - lo) * (int32_t) trend->scale) >> 13;
+
+	trend->time = time;
+
+	if (trend->count == 0 || dt > (uint32_t) trend->interval * TREND_MAX_GAP)
+	{
+		trend->x = z;
+		trend->v = 0;
+		trend->count = 1;
+		return 0;
+	}
+
+	// Tracking index, where 40 is 2 log2 of the ms^2 in a s^2
+
+	i = trend->logSquare - Trend_Log2x2(noise) + 2 * TREND_JERK_LOG2 - 40 - TREND_GAIN_MIN;
+	i = MAX(i, 0);
+	i = MIN(i, (int8_t) TREND_NUM_GAINS - 1);
+
+	// Predict, then correct by the innovation
+
+	x = trend->x + ((trend->v * (int32_t) ((dt * trend->perStep + 32768) >> 16)) >> 8);
+
+	err = z - x;
+	err = MAX(err, -TREND_MAX_ERROR);
+	err = MIN(err,  TREND_MAX_ERROR);
+
+	x += (pgm_read_word(&Trend_gains[i][0]) * err + 8192) >> 14;
+	trend->x = MIN(MAX(x, -TREND_MAX_VALUE), TREND_MAX_VALUE);
+
+	trend->v += (pgm_read_word(&Trend_gains[i][1]) * err + 8192) >> 14;
+	trend->v = MIN(MAX(trend->v, -TREND_MAX_STEP), TREND_MAX_STEP);
+
+	if (trend->count < 3 && ++trend->count < 3) return 0;
+
+	*rate = ((uint32_t) ABS(trend->v) * trend->perSecond) >> 12;
+	return 1;
+}
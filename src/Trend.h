@@ -0,0 +1,53 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef MGC_TREND_H
+#define MGC_TREND_H
+
+#include <stdint.h>
+
+#define TREND_JERK_LOG2 9 // Expected change in acceleration (2^n cm/s^3)
+#define TREND_MAX_GAP   4 // Longest gap between updates (intervals)
+
+typedef struct
+{
+	int32_t  x;          // Filtered value           (1/65536 of range)
+	int32_t  v;          // Filtered change          (1/65536 of range per interval)
+	uint32_t time;       // Time of the last update  (ms)
+	uint8_t  count;      // Updates since reset, up to 3
+
+	int32_t  min;        // Range the value is measured against
+	int32_t  max;
+	uint32_t scale;      // 2^29 / range
+	uint16_t interval;   // Nominal time between updates (ms)
+	uint32_t perStep;    // 2^24 / interval
+	uint16_t perSecond;  // 10^7 / interval / 16
+	int8_t   logSquare;  // 2 log2 of interval squared
+}
+Trend_t;
+
+void    Trend_Configure(Trend_t *trend, int32_t min, int32_t max, uint16_t interval);
+void    Trend_Reset(Trend_t *trend);
+uint8_t Trend_Update(Trend_t *trend, int32_t val, uint32_t time, uint32_t noise, int32_t *rate);
+
+#endif
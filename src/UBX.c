@@ -21,7 +21,6 @@
 **  Website: http://flysight.ca/                                          **
 ****************************************************************************/
 
-#include <math.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
@@ -30,16 +29,24 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <util/atomic.h>
 
 #include "Board/LEDs.h"
+#include "Angle.h"
+#include "Latency.h"
 #include "Log.h"
 #include "Main.h"
 #include "Power.h"
+#include "Predict.h"
 #include "Stack.h"
 #include "Timer.h"
+#include "Time.h"
 #include "Tone.h"
+#include "Track.h"
+#include "Trend.h"
 #include "uart.h"
 #include "UBX.h"
+#include "Version.h"
 
 /*
 #define STACK_PAINTING	// Define to enable stack debugging
@@ -53,6 +60,7 @@
 
 #define UBX_TIMEOUT         500 // ACK/NAK timeout (ms)
 #define UBX_MAX_PAYLOAD_LEN 92
+#define UBX_PAYLOAD_LEN     4  // Leading payload bytes kept for iTOW and ACK/NAK
 
 #define UBX_SYNC_1          0xb5
 #define UBX_SYNC_2          0x62
@@ -84,7 +92,8 @@
 #define UBX_NMEA_GPRMC      0x04
 #define UBX_NMEA_GPVTG      0x05
 
-#define UBX_SAVED_LEN       4
+#define UBX_SAVED_LEN       8  // Must be a power of 2
+#define UBX_RAW_LEN         MAIN_LOG_LEN // Must be a power of 2
 
 #define UBX_MSG_POSLLH      0x01
 #define UBX_MSG_SOL         0x02
@@ -94,10 +103,65 @@
 
 #define UBX_ALT_MIN         1500L // Minimum announced altitude (m)
 
+#define UBX_STATS_INTERVAL  10000 // Minimum interval between stats rows (ms)
+#define UBX_EPOCH_TIMEOUT   100   // Idle time before a partial epoch is committed (ms)
+
 #define UBX_HAS_FIX         0x01
 #define UBX_FIRST_FIX       0x02
 #define UBX_SAY_ALTITUDE    0x04
 #define UBX_VERTICAL_ACC    0x08
+#define UBX_IN_FLIGHT       0x10
+
+#define UBX_SYNC_TRACK      0x01
+#define UBX_SYNC_RAW        0x02
+#define UBX_SYNC_STATS      0x04
+
+typedef struct
+{
+	uint32_t baudRate; // Baud rate (bits/sec)
+	uint16_t ubrr;     // Baud rate register value for uart_init
+}
+UBX_baud_t;
+
+// Baud rates in order of preference. With U2X, 8 MHz divides exactly into
+// 500000 and 250000 baud, and 76800 and 38400 baud are within 0.2%. The
+// last entry is the receiver's factory default and is only used to probe.
+
+static const UBX_baud_t UBX_baud_rates[] PROGMEM =
+{
+	{500000, UART_BAUD_SELECT_DOUBLE_SPEED(500000, F_CPU)},
+	{250000, UART_BAUD_SELECT_DOUBLE_SPEED(250000, F_CPU)},
+	{ 76800, UART_BAUD_SELECT_DOUBLE_SPEED( 76800, F_CPU)},
+	{ 38400, UART_BAUD_SELECT(38400, F_CPU)},
+	{  9600, UART_BAUD_SELECT( 9600, F_CPU)}
+};
+
+#define UBX_NUM_BAUD_RATES  (sizeof(UBX_baud_rates) / sizeof(UBX_baud_t))
+#define UBX_NUM_BAUD_LADDER (UBX_NUM_BAUD_RATES - 1)
+
+// Receiver configuration, one acknowledged message per step
+
+#define UBX_INIT_PROBE   0
+#define UBX_INIT_SWITCH  1
+#define UBX_INIT_NMEA    2
+#define UBX_INIT_PVT     3
+#define UBX_INIT_SOL     4
+#define UBX_INIT_SOL_OFF 5
+#define UBX_INIT_NAV     6
+#define UBX_INIT_RATE    7
+#define UBX_INIT_NAV5    8
+#define UBX_INIT_DONE    9
+
+static const uint8_t UBX_init_nmea[] PROGMEM =
+{
+	UBX_NMEA_GPGGA, UBX_NMEA_GPGLL, UBX_NMEA_GPGSA,
+	UBX_NMEA_GPGSV, UBX_NMEA_GPRMC, UBX_NMEA_GPVTG
+};
+
+static const uint8_t UBX_init_nav[] PROGMEM =
+{
+	UBX_NAV_POSLLH, UBX_NAV_VELNED, UBX_NAV_TIMEUTC
+};
 
 static const uint16_t UBX_sas_table[] PROGMEM =
 {
@@ -109,7 +173,7 @@ static const uint16_t UBX_sas_table[] PROGMEM =
 static uint8_t  UBX_msg_class;
 static uint8_t  UBX_msg_id;
 static uint16_t UBX_payload_len;
-static uint8_t  UBX_payload[UBX_MAX_PAYLOAD_LEN];
+static uint8_t  UBX_payload[UBX_PAYLOAD_LEN];
 
 typedef struct
 {
@@ -301,6 +365,8 @@ UBX_ack_nak;
 
 uint8_t  UBX_model         = 7;
 uint16_t UBX_rate          = 200;
+uint16_t UBX_tone_int      = 0;
+uint16_t UBX_lead          = 0;
 uint8_t  UBX_mode          = 2;
 int32_t  UBX_min           = 0;
 int32_t  UBX_max           = 300;
@@ -326,10 +392,24 @@ uint8_t  UBX_init_mode     = 0;
 char     UBX_init_filename[9];
 
 static uint16_t UBX_sp_counter = 0;
+static uint32_t UBX_tone_time  = 0;
 
 int32_t  UBX_threshold     = 1000;
 int32_t  UBX_hThreshold    = 0;
 
+// Each sync rewrites the partial data sector and the directory sector. On a
+// host FAT image, 600 CSV rows (81 KB) took 1373 sector writes when synced
+// every row, 413 every 5 rows, 293 every 10 and 176 when only closed. For
+// binary rows (24 bytes) it was 1244, 284, 164 and 46. Syncing every 5 rows
+// or 1 s, i.e. 1 s at the default rate, saves 70-77% of the writes, and
+// longer windows save little more per row put at risk.
+
+uint8_t  UBX_sync_rows     = 5;
+uint16_t UBX_sync_int      = 1000;
+uint8_t  UBX_sync_phase    = 0;
+
+uint8_t  UBX_telemetry     = 0;
+
 UBX_alarm_t UBX_alarms[UBX_MAX_ALARMS];
 uint8_t     UBX_num_alarms   = 0;
 int32_t     UBX_alarm_window_above = 0;
@@ -337,6 +417,27 @@ int32_t     UBX_alarm_window_below = 0;
 
 static uint32_t UBX_time_of_week = 0;
 static uint8_t  UBX_msg_received = 0;
+#ifdef LATENCY_STATS
+static uint16_t UBX_rx_time;
+#endif
+static uint8_t  UBX_epoch_timer  = 0;
+
+static uint32_t UBX_stats_time = 0;
+static uint8_t  UBX_stats_due  = 0;
+
+volatile UBX_stats_t UBX_stats;
+
+static volatile uint8_t UBX_ack_received = 0;
+static volatile uint8_t UBX_ack_clsID;
+static volatile uint8_t UBX_ack_msgID;
+static uint8_t  UBX_pvt_only     = 0;
+
+static uint8_t  UBX_init_step    = UBX_INIT_DONE;
+static uint8_t  UBX_init_index;
+static uint8_t  UBX_init_baud;
+static uint8_t  UBX_init_class;
+static uint8_t  UBX_init_id;
+static uint8_t  UBX_init_waiting;
 
 UBX_buffer_t UBX_buffer;
 
@@ -345,8 +446,13 @@ uint8_t      UBX_num_windows = 0;
 
 int32_t UBX_dz_elev = 0;
 
+uint32_t UBX_baud = 0;
+
 typedef struct
 {
+	uint32_t iTOW;     // GPS time of week             (ms)
+	uint8_t  valid;    // Messages received (UBX_MSG_*)
+
 	int32_t  lon;      // Longitude                    (deg)
 	int32_t  lat;      // Latitude                     (deg)
 	int32_t  hMSL;     // Height above mean sea level  (mm)
@@ -372,12 +478,148 @@ typedef struct
 	uint8_t  hour;     // Hour of day                  (0..23)
 	uint8_t  min;      // Minute of hour               (0..59)
 	uint8_t  sec;      // Second of minute             (0..59)
+
+#ifdef LATENCY_STATS
+	uint16_t rxTime;     // Uptime at first byte         (ms)
+	uint16_t commitTime; // Uptime at commit             (ms)
+#endif
 }
 UBX_saved_t ;
 static UBX_saved_t UBX_saved[UBX_SAVED_LEN];
 
-static uint8_t UBX_read  = 0;
-static uint8_t UBX_write = 0;
+typedef struct
+{
+	uint8_t offset;    // Offset of field in message payload
+	uint8_t size;      // Size of field                 (bytes)
+	uint8_t dest;      // Offset of field in UBX_saved_t
+}
+UBX_field_t;
+
+#define UBX_FIELD(m,f,d) {offsetof(m, f), sizeof(((m *) 0)->f), offsetof(UBX_saved_t, d)}
+
+static const UBX_field_t UBX_fields_posllh[] PROGMEM =
+{
+	UBX_FIELD(UBX_nav_posllh, lon,  lon),
+	UBX_FIELD(UBX_nav_posllh, lat,  lat),
+	UBX_FIELD(UBX_nav_posllh, hMSL, hMSL),
+	UBX_FIELD(UBX_nav_posllh, hAcc, hAcc),
+	UBX_FIELD(UBX_nav_posllh, vAcc, vAcc)
+};
+
+static const UBX_field_t UBX_fields_sol[] PROGMEM =
+{
+	UBX_FIELD(UBX_nav_sol, gpsFix, gpsFix),
+	UBX_FIELD(UBX_nav_sol, numSV,  numSV)
+};
+
+static const UBX_field_t UBX_fields_pvt[] PROGMEM =
+{
+	UBX_FIELD(UBX_nav_pvt, year,    year),
+	UBX_FIELD(UBX_nav_pvt, month,   month),
+	UBX_FIELD(UBX_nav_pvt, day,     day),
+	UBX_FIELD(UBX_nav_pvt, hour,    hour),
+	UBX_FIELD(UBX_nav_pvt, min,     min),
+	UBX_FIELD(UBX_nav_pvt, sec,     sec),
+	UBX_FIELD(UBX_nav_pvt, nano,    nano),
+	UBX_FIELD(UBX_nav_pvt, gpsFix,  gpsFix),
+	UBX_FIELD(UBX_nav_pvt, numSV,   numSV),
+	UBX_FIELD(UBX_nav_pvt, lon,     lon),
+	UBX_FIELD(UBX_nav_pvt, lat,     lat),
+	UBX_FIELD(UBX_nav_pvt, hMSL,    hMSL),
+	UBX_FIELD(UBX_nav_pvt, hAcc,    hAcc),
+	UBX_FIELD(UBX_nav_pvt, vAcc,    vAcc),
+	UBX_FIELD(UBX_nav_pvt, velN,    velN),
+	UBX_FIELD(UBX_nav_pvt, velE,    velE),
+	UBX_FIELD(UBX_nav_pvt, velD,    velD),
+	UBX_FIELD(UBX_nav_pvt, gSpeed,  gSpeed),
+	UBX_FIELD(UBX_nav_pvt, headMot, heading),
+	UBX_FIELD(UBX_nav_pvt, sAcc,    sAcc),
+	UBX_FIELD(UBX_nav_pvt, headAcc, cAcc)
+};
+
+static const UBX_field_t UBX_fields_velned[] PROGMEM =
+{
+	UBX_FIELD(UBX_nav_velned, velN,    velN),
+	UBX_FIELD(UBX_nav_velned, velE,    velE),
+	UBX_FIELD(UBX_nav_velned, velD,    velD),
+	UBX_FIELD(UBX_nav_velned, speed,   speed),
+	UBX_FIELD(UBX_nav_velned, gSpeed,  gSpeed),
+	UBX_FIELD(UBX_nav_velned, heading, heading),
+	UBX_FIELD(UBX_nav_velned, sAcc,    sAcc),
+	UBX_FIELD(UBX_nav_velned, cAcc,    cAcc)
+};
+
+static const UBX_field_t UBX_fields_timeutc[] PROGMEM =
+{
+	UBX_FIELD(UBX_nav_timeutc, nano,  nano),
+	UBX_FIELD(UBX_nav_timeutc, year,  year),
+	UBX_FIELD(UBX_nav_timeutc, month, month),
+	UBX_FIELD(UBX_nav_timeutc, day,   day),
+	UBX_FIELD(UBX_nav_timeutc, hour,  hour),
+	UBX_FIELD(UBX_nav_timeutc, min,   min),
+	UBX_FIELD(UBX_nav_timeutc, sec,   sec)
+};
+
+#undef UBX_FIELD
+
+typedef struct
+{
+	uint8_t            msgClass;  // Message class
+	uint8_t            msgID;     // Message identifier
+	uint8_t            valid;     // UBX_MSG_* bits covering the fields
+	uint8_t            numFields; // Number of fields
+	const UBX_field_t *fields;    // Fields, in order of payload offset
+}
+UBX_decoder_t;
+
+#define UBX_DECODER(c,m,v,f) {c, m, v, sizeof(f) / sizeof(UBX_field_t), f}
+
+static const UBX_decoder_t UBX_decoders[] PROGMEM =
+{
+	UBX_DECODER(UBX_NAV, UBX_NAV_POSLLH,  UBX_MSG_POSLLH,  UBX_fields_posllh),
+	UBX_DECODER(UBX_NAV, UBX_NAV_SOL,     UBX_MSG_SOL,     UBX_fields_sol),
+	UBX_DECODER(UBX_NAV, UBX_NAV_PVT,     UBX_MSG_ALL,     UBX_fields_pvt),
+	UBX_DECODER(UBX_NAV, UBX_NAV_VELNED,  UBX_MSG_VELNED,  UBX_fields_velned),
+	UBX_DECODER(UBX_NAV, UBX_NAV_TIMEUTC, UBX_MSG_TIMEUTC, UBX_fields_timeutc)
+};
+
+#undef UBX_DECODER
+
+#define UBX_NUM_DECODERS (sizeof(UBX_decoders) / sizeof(UBX_decoder_t))
+
+static const UBX_field_t *UBX_field_ptr;   // Next field to be decoded
+static uint8_t            UBX_field_count; // Number of fields remaining
+static UBX_field_t        UBX_field;       // Field currently being decoded
+static uint8_t           *UBX_field_dest;  // Record fields are written to
+static uint8_t            UBX_field_valid; // UBX_MSG_* bits of the message
+
+// Records are filled and queued by the UART receive interrupt at
+// UBX_write, processed by the main loop at UBX_proc, and logged at 
+// UBX_read.
+
+static volatile uint8_t UBX_read  = 0;
+static          uint8_t UBX_proc  = 0;
+static volatile uint8_t UBX_write = 0;
+
+static uint8_t * const   UBX_raw = MAIN_LOG_BUFFER;
+static volatile uint16_t UBX_raw_read    = 0; // Next byte to be logged
+static volatile uint16_t UBX_raw_write   = 0; // End of the last valid frame
+static          uint16_t UBX_raw_index   = 0; // End of the frame being received
+static          uint8_t  UBX_raw_full    = 0; // Frame did not fit in the buffer
+static volatile uint8_t  UBX_raw_enabled = 0;
+
+static FIL *UBX_flush_file = &Main_file;
+
+static          uint8_t  UBX_sync_files = 0; // Files with unsaved data (UBX_SYNC_*)
+static          uint8_t  UBX_sync_count = 0; // Rows written since the last sync
+static          uint8_t  UBX_sync_now   = 0; // Sync without waiting for the limits
+static volatile uint16_t UBX_sync_timer = 0; // Time since the last sync (ms)
+
+static uint32_t UBX_track_time;  // Time that track records are relative to
+static int32_t  UBX_track_lat;   // Position that track records are relative to
+static int32_t  UBX_track_lon;
+static int32_t  UBX_track_hMSL;
+static uint8_t  UBX_track_key;   // Next position is written in a key record
 
 static uint8_t UBX_flags = 0;
 static uint8_t UBX_prev_flags = 0;
@@ -386,19 +628,30 @@ static int32_t UBX_prevHMSL;
 
 static uint8_t UBX_suppress_tone = 0;
 
+static Trend_t UBX_trend;
+
 static char UBX_speech_buf[16] = "\0";
 static char *UBX_speech_ptr = UBX_speech_buf;
 
 #ifdef STACK_PAINTING
-static const char UBX_header[] PROGMEM = 
+const char UBX_header[] PROGMEM = 
 	"time,lat,lon,hMSL,velN,velE,velD,hAcc,vAcc,sAcc,heading,cAcc,gpsFix,numSV,stack\r\n"
 	",(deg),(deg),(m),(m/s),(m/s),(m/s),(m),(m),(m/s),(deg),(deg),,,\r\n";
 #else
-static const char UBX_header[] PROGMEM = 
+const char UBX_header[] PROGMEM = 
 	"time,lat,lon,hMSL,velN,velE,velD,hAcc,vAcc,sAcc,heading,cAcc,gpsFix,numSV\r\n"
 	",(deg),(deg),(m),(m/s),(m/s),(m/s),(m),(m),(m/s),(deg),(deg),,\r\n";
 #endif
 
+static const char UBX_track_version[] PROGMEM = FLYSIGHT_VERSION;
+
+static const char UBX_stats_header[] PROGMEM = 
+	"frameErrors,overrunErrors,checksumErrors,lengthErrors,ringOverflows,rawOverflows,incompleteEpochs,epochs,syncs,sdWrites,holdTime,upTime"
+#ifdef LATENCY_STATS
+	",gpsMin,gpsMean,gpsMax,rxMin,rxMean,rxMax,procMin,procMean,procMax,beepMin,beepMean,beepMax,outMin,outMean,outMax,totalMin,totalMean,totalMax,tones,beeps"
+#endif
+	"\r\n";
+
 static enum
 {
 	st_idle,
@@ -409,11 +662,64 @@ static enum
 UBX_state = st_idle;
 
 extern int disk_is_ready(void);
+extern DWORD disk_write_count;
+
+static void UBX_CommitRecord(void)
+{
+	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
+
+	if (!UBX_msg_received) return;
+
+	if (UBX_msg_received != UBX_MSG_ALL)
+	{
+		++UBX_stats.incompleteEpochs;
+	}
+
+	// Queue the record for the main loop with whatever fields arrived
+
+	current->iTOW  = UBX_time_of_week;
+	current->valid = UBX_msg_received;
+#ifdef LATENCY_STATS
+	current->rxTime     = UBX_rx_time;
+	current->commitTime = Latency_Now();
+#endif
+	++UBX_write;
+
+	++UBX_stats.epochs;
+
+	UBX_msg_received = 0;
+}
 
 void UBX_Update(void)
 {
 	static uint16_t counter;
 
+	// Commit a partial epoch once the receiver has gone quiet. This runs in
+	// the timer interrupt, so it can't interleave with the UART interrupt.
+
+	if (UBX_msg_received && ++UBX_epoch_timer >= UBX_EPOCH_TIMEOUT)
+	{
+		UBX_CommitRecord();
+	}
+
+	if (UBX_sync_timer < UINT16_MAX)
+	{
+		++UBX_sync_timer;
+	}
+
+	++UBX_stats.upTime;
+	if (Power_IsHeld())
+	{
+		++UBX_stats.holdTime;
+	}
+
+	// Over USB, the main loop shows the charge status on the LEDs
+
+	if (UBX_telemetry)
+	{
+		return;
+	}
+
 	static enum
 	{
 		st_solid,
@@ -454,6 +760,113 @@ void UBX_Update(void)
 	}
 }
 
+static void UBX_NextField(void)
+{
+	if (UBX_field_count)
+	{
+		memcpy_P(&UBX_field, UBX_field_ptr++, sizeof(UBX_field_t));
+		--UBX_field_count;
+	}
+	else
+	{
+		UBX_field.size = 0;
+	}
+}
+
+static void UBX_FindDecoder(void)
+{
+	uint8_t i;
+
+	UBX_field_count = 0;
+	UBX_field.size = 0;
+
+	for (i = 0; i < UBX_NUM_DECODERS; ++i)
+	{
+		if (pgm_read_byte(&UBX_decoders[i].msgClass) == UBX_msg_class &&
+		    pgm_read_byte(&UBX_decoders[i].msgID) == UBX_msg_id)
+		{
+			UBX_field_ptr = (const UBX_field_t *) pgm_read_word(&UBX_decoders[i].fields);
+			UBX_field_count = pgm_read_byte(&UBX_decoders[i].numFields);
+			UBX_field_valid = pgm_read_byte(&UBX_decoders[i].valid);
+			break;
+		}
+	}
+}
+
+static void UBX_StartRecord(void)
+{
+	// A message from a new epoch commits whatever arrived for the previous
+	// one. iTOW always precedes the decoded fields, so this happens before 
+	// any of them are written.
+
+	if (*((uint32_t *) UBX_payload) != UBX_time_of_week)
+	{
+		UBX_CommitRecord();
+	}
+
+#ifdef LATENCY_STATS
+	if (!UBX_msg_received)
+	{
+		UBX_rx_time = Latency_Now();
+	}
+#endif
+
+	// Fields are written straight into the current record, before the
+	// checksum is known. A frame that fails it may have overwritten fields
+	// of earlier messages, so UBX_DropFields then marks those as missing.
+	// If the ring is full, the message is dropped so that records still
+	// waiting to be logged are left untouched.
+
+	if ((uint8_t) (UBX_read + UBX_SAVED_LEN) == UBX_write)
+	{
+		++UBX_stats.ringOverflows;
+		UBX_field_count = 0;
+		UBX_field.size = 0;
+	}
+	else
+	{
+		UBX_field_dest = (uint8_t *) (UBX_saved + (UBX_write % UBX_SAVED_LEN));
+	}
+}
+
+static void UBX_DropFields(void)
+{
+	if (UBX_field_dest)
+	{
+		UBX_msg_received &= ~UBX_field_valid;
+	}
+}
+
+static void UBX_SaveRaw(
+	unsigned char ch)
+{
+	// Bytes are copied as they arrive, but only become visible to the
+	// logger once the whole frame has passed its checksum
+
+	if ((uint16_t) (UBX_raw_index - UBX_raw_read) < UBX_RAW_LEN)
+	{
+		UBX_raw[UBX_raw_index++ % UBX_RAW_LEN] = ch;
+	}
+	else
+	{
+		UBX_raw_full = 1;
+	}
+}
+
+static void UBX_CommitRaw(void)
+{
+	if (!UBX_raw_enabled) return;
+
+	if (UBX_raw_full)
+	{
+		++UBX_stats.rawOverflows;
+	}
+	else
+	{
+		UBX_raw_write = UBX_raw_index;
+	}
+}
+
 static uint8_t UBX_HandleByte(
 	unsigned char ch)
 {
@@ -475,6 +888,19 @@ static uint8_t UBX_HandleByte(
 	
 	static uint8_t ck_a, ck_b;
 	static uint16_t index;
+
+	if (UBX_raw_enabled)
+	{
+		// Anything received outside a frame is discarded
+
+		if (state == st_sync_1)
+		{
+			UBX_raw_index = UBX_raw_write;
+			UBX_raw_full = 0;
+		}
+
+		UBX_SaveRaw(ch);
+	}
 	
 	switch (state)
 	{
@@ -496,11 +922,13 @@ static uint8_t UBX_HandleByte(
 		break;
 	case st_class:
 		UBX_msg_class = ch;
+		UBX_field_dest = 0;
 		ck_a = ck_b = ch;
 		state = st_id;
 		break;
 	case st_id:
 		UBX_msg_id = ch;
+		UBX_FindDecoder();
 		ck_a += ch;
 		ck_b += ck_a;
 		state = st_length_1;
@@ -521,16 +949,35 @@ static uint8_t UBX_HandleByte(
 		}
 		else if (UBX_payload_len <= UBX_MAX_PAYLOAD_LEN)
 		{
+			UBX_NextField();
 			state = st_payload;
 			index = 0;
 		}
 		else
 		{
+			++UBX_stats.lengthErrors;
 			state = st_sync_1;
 		}
 		break;
 	case st_payload:
-		UBX_payload[index++] = ch;
+		if (index < UBX_PAYLOAD_LEN)
+		{
+			UBX_payload[index] = ch;
+
+			if (index == UBX_PAYLOAD_LEN - 1 && UBX_field.size)
+			{
+				UBX_StartRecord();
+			}
+		}
+		if (UBX_field.size && index >= UBX_field.offset)
+		{
+			UBX_field_dest[UBX_field.dest + index - UBX_field.offset] = ch;
+			if (index - UBX_field.offset + 1 == UBX_field.size)
+			{
+				UBX_NextField();
+			}
+		}
+		++index;
 		ck_a += ch;
 		ck_b += ck_a;
 		if (index == UBX_payload_len)
@@ -545,6 +992,8 @@ static uint8_t UBX_HandleByte(
 		}
 		else
 		{
+			++UBX_stats.checksumErrors;
+			UBX_DropFields();
 			state = st_sync_1;
 		}
 		break;
@@ -553,6 +1002,11 @@ static uint8_t UBX_HandleByte(
 		{
 			ret = 1;
 		}
+		else
+		{
+			++UBX_stats.checksumErrors;
+			UBX_DropFields();
+		}
 		state = st_sync_1;
 		break;
 	}
@@ -560,48 +1014,6 @@ static uint8_t UBX_HandleByte(
 	return ret;
 }
 
-static uint8_t UBX_WaitForAck(
-	uint8_t  msg_class,
-	uint8_t  msg_id,
-	uint16_t timeout)
-{
-	unsigned int ch;
-
-	Timer_Set(timeout);
-	
-	while (Timer_Get() != 0)
-	{
-		if ((ch = uart_getc()) != UART_NO_DATA)
-		{
-			if (UBX_HandleByte(ch))
-			{
-				if (UBX_msg_class == UBX_ACK &&
-				    UBX_msg_id == UBX_ACK_ACK)
-				{
-					UBX_ack_ack ack = *((UBX_ack_ack *) UBX_payload);
-					if (ack.clsID == msg_class &&
-					    ack.msgID == msg_id)
-					{
-						return 1; // ACK
-					}
-				}
-				else if (UBX_msg_class == UBX_ACK &&
-				         UBX_msg_id == UBX_ACK_NAK)
-				{
-					UBX_ack_nak nak = *((UBX_ack_nak *) UBX_payload);
-					if (nak.clsID == msg_class &&
-					    nak.msgID == msg_id)
-					{
-						return 0; // NAK
-					}
-				}
-			}
-		}
-	}
-
-	return 0;
-}
-
 static void UBX_SendMessage(
 	uint8_t  msg_class,
 	uint8_t  msg_id,
@@ -612,6 +1024,8 @@ static void UBX_SendMessage(
 	uint8_t  *bytes = (uint8_t *) data;
 	uint8_t  ck_a = 0, ck_b = 0;
 
+	UBX_ack_received = 0;
+
 	uart_putc(UBX_SYNC_1);
 	uart_putc(UBX_SYNC_2);
 
@@ -634,6 +1048,13 @@ static void UBX_SendMessage(
 	uart_putc(ck_b);
 }
 
+static void UBX_SetBaudRate(
+	uint8_t i)
+{
+	uart_init(pgm_read_word(&UBX_baud_rates[i].ubrr));
+	_delay_ms(10); // wait for GPS UART to reset
+}
+
 static void UBX_SetTone(
 	int32_t val_1,
 	int32_t min_1,
@@ -785,7 +1206,9 @@ static void UBX_GetValues(
 		*val = (current->speed * 1024) / speed_mul;
 		break;
 	case 11: // Dive angle
-		*val = atan2(current->velD, current->gSpeed) / M_PI * 180;
+		*val = Angle_Atan2(current->velD, current->gSpeed);
+		*min *= 100;
+		*max *= 100;
 		break;
 	}
 }
@@ -924,7 +1347,7 @@ static void UBX_SpeakValue(
 		UBX_speech_ptr = Log_WriteInt32ToBuf(UBX_speech_ptr, (current->speed * 1024) / speed_mul, 2, 1, 0);
 		break;
 	case 11: // Dive angle
-		UBX_speech_ptr = Log_WriteInt32ToBuf(UBX_speech_ptr, 100 * atan2(current->velD, current->gSpeed) / M_PI * 180, 2, 1, 0);
+		UBX_speech_ptr = Log_WriteInt32ToBuf(UBX_speech_ptr, Angle_Atan2(current->velD, current->gSpeed), 2, 1, 0);
 		break;
 	case 12: // Altitude
 		if (UBX_speech[UBX_cur_speech].units == UBX_UNITS_KMH)
@@ -1097,15 +1520,107 @@ static void UBX_UpdateAlarms(
 	}
 }
 
+// Fields extrapolated by UBX_lead before tone values are derived from them.
+// All but the first are magnitudes.
+
+static const uint8_t UBX_predict_fields[] PROGMEM =
+{
+	offsetof(UBX_saved_t, velD),
+	offsetof(UBX_saved_t, gSpeed),
+	offsetof(UBX_saved_t, speed)
+};
+
+#define UBX_NUM_PREDICT (sizeof(UBX_predict_fields) / sizeof(uint8_t))
+
+static uint8_t UBX_Predict(
+	UBX_saved_t *current,
+	int32_t *motion)
+{
+	UBX_saved_t *saved[PREDICT_LEN];
+	uint16_t age[PREDICT_LEN];
+	int32_t  x[PREDICT_LEN];
+	uint8_t  i, j, n, offset;
+
+	// current is the record at UBX_proc. Earlier records stay in the ring
+	// until the receiver reuses their slots.
+
+	saved[0] = current;
+	age[0] = 0;
+
+	for (n = 1; n < PREDICT_LEN; ++n)
+	{
+		UBX_saved_t *prev = UBX_saved + ((uint8_t) (UBX_proc - n) % UBX_SAVED_LEN);
+		uint32_t dt = current->iTOW - prev->iTOW;
+
+		if (!(prev->valid & UBX_MSG_VELNED) ||
+		    prev->gpsFix != 0x03 ||
+		    dt <= age[n - 1] ||
+		    dt > PREDICT_MAX_AGE) break;
+
+		saved[n] = prev;
+		age[n] = dt;
+	}
+
+	if (n < 2) return 0;
+
+	for (i = 0; i < UBX_NUM_PREDICT; ++i)
+	{
+		offset = pgm_read_byte(&UBX_predict_fields[i]);
+
+		for (j = 0; j < n; ++j)
+		{
+			x[j] = *((int32_t *) ((uint8_t *) saved[j] + offset));
+		}
+
+		motion[i] = Predict_Value(x, age, n, UBX_lead);
+
+		if (i > 0 && motion[i] < 0)
+		{
+			motion[i] = 0;
+		}
+	}
+
+	// The receiver fills the slot at UBX_write. The oldest record was read
+	// intact if that slot has not reached it since.
+
+	return n - 1 < UBX_SAVED_LEN - (uint8_t) (UBX_write - UBX_proc);
+}
+
+static void UBX_SwapMotion(
+	UBX_saved_t *current,
+	int32_t *motion)
+{
+	int32_t *field, tmp;
+	uint8_t i;
+
+	for (i = 0; i < UBX_NUM_PREDICT; ++i)
+	{
+		field = (int32_t *) ((uint8_t *) current + pgm_read_byte(&UBX_predict_fields[i]));
+		tmp = *field;
+		*field = motion[i];
+		motion[i] = tmp;
+	}
+}
+
 static void UBX_UpdateTones(
-	UBX_saved_t *current)
+	UBX_saved_t *current,
+	uint32_t time_of_week)
 {
-	static int32_t x0 = UBX_INVALID_VALUE, x1, x2;
-	
 	int32_t val_1 = UBX_INVALID_VALUE, min_1 = UBX_min, max_1 = UBX_max;
 	int32_t val_2 = UBX_INVALID_VALUE, min_2 = UBX_min_2, max_2 = UBX_max_2;
+	int32_t motion[UBX_NUM_PREDICT];
 	
-	uint8_t i;
+	uint8_t i, predict;
+
+	// Tone values are derived from velocities extrapolated past the
+	// latency of the receiver and of the tone itself. Speech and the
+	// thresholds below still use the measured values.
+
+	predict = UBX_lead && UBX_Predict(current, motion);
+	if (predict)
+	{
+		UBX_SwapMotion(current, motion);
+	}
 
 	UBX_GetValues(current, UBX_mode, &val_1, &min_1, &max_1);
 
@@ -1119,17 +1634,14 @@ static void UBX_UpdateTones(
 	}
 	else if (UBX_mode_2 == 9)
 	{
-		x2 = x1;
-		x1 = x0;
-		x0 = val_1;
-
-		if (x0 != UBX_INVALID_VALUE && 
-			x1 != UBX_INVALID_VALUE && 
-			x2 != UBX_INVALID_VALUE &&
-			max_1 != min_1)
+		if (val_1 == UBX_INVALID_VALUE)
+		{
+			Trend_Reset(&UBX_trend);
+		}
+		else
 		{
-			val_2 = (int32_t) 1000 * (x2 - x0) / (int32_t) (2 * UBX_rate);
-			val_2 = (int32_t) 10000 * ABS(val_2) / ABS(max_1 - min_1);
+			Trend_Configure(&UBX_trend, min_1, max_1, MAX(UBX_rate, UBX_tone_int));
+			Trend_Update(&UBX_trend, val_1, time_of_week, current->sAcc, &val_2);
 		}
 	}
 	else
@@ -1137,11 +1649,19 @@ static void UBX_UpdateTones(
 		UBX_GetValues(current, UBX_mode_2, &val_2, &min_2, &max_2);
 	}
 
+	if (predict)
+	{
+		UBX_SwapMotion(current, motion);
+	}
+
 	if (!UBX_suppress_tone)
 	{
 		if (ABS(current->velD) >= UBX_threshold && 
 			current->gSpeed >= UBX_hThreshold)
 		{
+#ifdef LATENCY_STATS
+			Latency_Tone(current->iTOW, current->rxTime, current->commitTime);
+#endif
 			UBX_SetTone(val_1, min_1, max_1, val_2, min_2, max_2);
 				
 			if (UBX_sp_rate != 0 &&
@@ -1176,59 +1696,205 @@ static void UBX_UpdateTones(
 
 	if (UBX_sp_counter < UBX_sp_rate)
 	{
-		UBX_sp_counter += UBX_rate;
+		UBX_sp_counter += MIN(time_of_week - UBX_tone_time, UBX_sp_rate);
 	}
+
+	UBX_tone_time = time_of_week;
 }
 
-static void UBX_ReceiveMessage(
-	uint8_t msg_received, 
-	uint32_t time_of_week)
+static void UBX_WriteTrackHeader(
+	UBX_saved_t *current)
 {
-	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
+	Track_header_t *header = (Track_header_t *) UBX_buffer.buffer;
+
+	memcpy(header->magic, TRACK_MAGIC, sizeof(header->magic));
+	header->version   = TRACK_VERSION;
+	header->recordLen = sizeof(Track_record_t);
+	header->headerLen = sizeof(Track_header_t) + sizeof(UBX_track_version);
+
+	header->year      = current->year;
+	header->month     = current->month;
+	header->day       = current->day;
+	header->hour      = current->hour;
+	header->min       = current->min;
+	header->sec       = current->sec;
+	header->reserved  = 0;
+
+	header->hAccScale = TRACK_HACC_SCALE;
+	header->vAccScale = TRACK_VACC_SCALE;
+	header->sAccScale = TRACK_SACC_SCALE;
+	header->headScale = TRACK_HEAD_SCALE;
+	header->cAccScale = TRACK_CACC_SCALE;
+
+	Log_Write(header, sizeof(Track_header_t));
+	Log_WriteString(UBX_track_version);
+	Log_WriteChar(0);
+
+	UBX_track_time = mk_gmtime(
+		current->year, current->month, current->day,
+		current->hour, current->min, current->sec);
+	UBX_track_key = 1;
+}
 
-	if (time_of_week != UBX_time_of_week)
+static uint16_t UBX_Sqrt(
+	uint32_t x)
+{
+	uint32_t res = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > x)
 	{
-		UBX_time_of_week = time_of_week;
-		UBX_msg_received = 0;
+		bit >>= 2;
 	}
 
-	UBX_msg_received |= msg_received;
+	while (bit)
+	{
+		if (x >= res + bit)
+		{
+			x -= res + bit;
+			res = (res >> 1) + bit;
+		}
+		else
+		{
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
 
-	if (UBX_msg_received == UBX_MSG_ALL)
+	return res;
+}
+
+static void UBX_ProcessEpoch(
+	UBX_saved_t *current)
+{
+	if (UBX_pvt_only)
+	{
+		// NAV-PVT velocities are given in mm/s and are converted to the 
+		// cm/s used by NAV-VELNED.
+
+		current->velN   /= 10;
+		current->velE   /= 10;
+		current->velD   /= 10;
+		current->gSpeed /= 10;
+		current->speed   = UBX_Sqrt(
+			(uint32_t) (current->gSpeed * current->gSpeed) + 
+			(uint32_t) (current->velD * current->velD));
+		current->sAcc   /= 10;
+	}
+
+	// Fields from missing messages are left over from an earlier record. 
+	// Without NAV-SOL, the previous fix state is carried over; without 
+	// NAV-POSLLH, the previous height is used for tones.
+
+	if (current->valid & UBX_MSG_SOL)
 	{
 		if (current->gpsFix == 0x03)
 		{
 			UBX_flags |= UBX_HAS_FIX;
+		}
+		else
+		{
+			UBX_flags &= ~UBX_HAS_FIX;
+		}
+	}
+	else
+	{
+		current->gpsFix = (UBX_flags & UBX_HAS_FIX) ? 0x03 : 0x00;
+	}
+
+	if (!(current->valid & UBX_MSG_POSLLH))
+	{
+		current->hMSL = UBX_prevHMSL;
+	}
 
+	// Over USB, the host owns the card, and epochs are only reported
+
+	if ((UBX_flags & UBX_HAS_FIX) && !UBX_telemetry)
+	{
+		if (current->valid & UBX_MSG_POSLLH)
+		{
 			UBX_UpdateAlarms(current);
-			UBX_UpdateTones(current);
+		}
 
-			if (!Log_IsInitialized())
-			{
-				Power_Hold();
+		// In high-rate mode, tones are updated from the latest sample at
+		// their own interval rather than on every measurement.
 
-				Log_Init(
-					current->year,
-					current->month,
-					current->day,
-					current->hour,
-					current->min,
-					current->sec);
+		if ((current->valid & UBX_MSG_VELNED) &&
+		    (current->iTOW - UBX_tone_time >= UBX_tone_int))
+		{
+			UBX_UpdateTones(current, current->iTOW);
+		}
 
-				Log_WriteString(UBX_header);
-				UBX_state = st_flush_1;
+		if (!Log_IsInitialized() && (current->valid & UBX_MSG_TIMEUTC))
+		{
+			Power_Hold();
+
+			Log_Init(
+				current->year,
+				current->month,
+				current->day,
+				current->hour,
+				current->min,
+				current->sec);
+
+#ifdef LATENCY_STATS
+			// Latency statistics cover this track only
+			Latency_Reset();
+#endif
 
-				UBX_flags |= UBX_FIRST_FIX;
+			if (Log_track != LOG_TRACK_NONE)
+			{
+				if (Log_track == LOG_TRACK_CSV)
+				{
+					Log_WriteString(UBX_header);
+				}
+				else
+				{
+					UBX_WriteTrackHeader(current);
+				}
+
+				UBX_sync_files |= UBX_SYNC_TRACK;
+				UBX_sync_now = 1;
+			}
+			else
+			{
+				Power_Release();
 			}
 
-			++UBX_write;
+			UBX_raw_enabled = Log_enable_raw && Log_IsInitialized();
+
+			UBX_flags |= UBX_FIRST_FIX;
+		}
+	}
+	else
+	{
+		Tone_SetRate(0);
+	}
+
+	if (current->valid & UBX_MSG_VELNED)
+	{
+		if (ABS(current->velD) >= UBX_threshold &&
+		    current->gSpeed >= UBX_hThreshold)
+		{
+			UBX_flags |= UBX_IN_FLIGHT;
 		}
 		else
 		{
-			UBX_flags &= ~UBX_HAS_FIX;
-			Tone_SetRate(0);
+			UBX_flags &= ~UBX_IN_FLIGHT;
 		}
+	}
+
+	// Entering or leaving flight, or losing the fix, saves the log 
+	// straight away
 
+	if (UBX_sync_phase && 
+	    ((UBX_flags ^ UBX_prev_flags) & (UBX_IN_FLIGHT | UBX_HAS_FIX)))
+	{
+		UBX_sync_now = 1;
+	}
+
+	if (current->valid & UBX_MSG_POSLLH)
+	{
 		if (current->vAcc < 10000)
 		{
 			UBX_flags |= UBX_VERTICAL_ACC;
@@ -1237,93 +1903,77 @@ static void UBX_ReceiveMessage(
 		{
 			UBX_flags &= ~UBX_VERTICAL_ACC;
 		}
+	}
 
-		UBX_prev_flags = UBX_flags;
-		UBX_prevHMSL = current->hMSL;
+	UBX_prev_flags = UBX_flags;
+	UBX_prevHMSL = current->hMSL;
 
-		UBX_msg_received = 0;
+	if (current->iTOW - UBX_stats_time >= UBX_STATS_INTERVAL)
+	{
+		UBX_stats_time = current->iTOW;
+		UBX_stats_due = 1;
 	}
 }
 
-static void UBX_HandleNavSol(void)
+static void UBX_ReceiveMessage(
+	uint8_t msg_received, 
+	uint32_t time_of_week)
 {
-	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
-	UBX_nav_sol *nav_sol = (UBX_nav_sol *) UBX_payload;
+	if (time_of_week != UBX_time_of_week)
+	{
+		UBX_CommitRecord();
+		UBX_time_of_week = time_of_week;
+	}
 
-	current->gpsFix = nav_sol->gpsFix;
-	current->numSV  = nav_sol->numSV;
+	UBX_msg_received |= msg_received;
 
-	UBX_ReceiveMessage(UBX_MSG_SOL, nav_sol->iTOW);
+	if (UBX_msg_received == UBX_MSG_ALL)
+	{
+		UBX_CommitRecord();
+	}
 }
 
-static void UBX_HandleNavPvt(void)
+static void UBX_HandleNavSol(void)
 {
-	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
-	UBX_nav_pvt *nav_pvt = (UBX_nav_pvt *) UBX_payload;
-
-	current->gpsFix = nav_pvt->gpsFix;
-	current->numSV  = nav_pvt->numSV;
+	UBX_ReceiveMessage(UBX_MSG_SOL, *((uint32_t *) UBX_payload));
+}
 
-	UBX_ReceiveMessage(UBX_MSG_SOL, nav_pvt->iTOW);
+static void UBX_HandleNavPvt(void)
+{
+	UBX_ReceiveMessage(UBX_MSG_ALL, *((uint32_t *) UBX_payload));
 }
 
 static void UBX_HandlePosition(void)
 {
-	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
-	UBX_nav_posllh *nav_pos_llh = (UBX_nav_posllh *) UBX_payload;
-
-	current->lon  = nav_pos_llh->lon;
-	current->lat  = nav_pos_llh->lat;
-	current->hMSL = nav_pos_llh->hMSL;
-	current->hAcc = nav_pos_llh->hAcc;
-	current->vAcc = nav_pos_llh->vAcc;
-
-	UBX_ReceiveMessage(UBX_MSG_POSLLH, nav_pos_llh->iTOW);
+	UBX_ReceiveMessage(UBX_MSG_POSLLH, *((uint32_t *) UBX_payload));
 }
 
 static void UBX_HandleVelocity(void)
 {
-	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
-	UBX_nav_velned *nav_velned = (UBX_nav_velned *) UBX_payload;
-
-	current->velN    = nav_velned->velN;
-	current->velE    = nav_velned->velE;
-	current->velD    = nav_velned->velD;
-	current->speed   = nav_velned->speed;
-	current->gSpeed  = nav_velned->gSpeed;
-	current->heading = nav_velned->heading;
-	current->sAcc    = nav_velned->sAcc;
-	current->cAcc    = nav_velned->cAcc;
-
-	UBX_ReceiveMessage(UBX_MSG_VELNED, nav_velned->iTOW);
+	UBX_ReceiveMessage(UBX_MSG_VELNED, *((uint32_t *) UBX_payload));
 }
 
 static void UBX_HandleTimeUTC(void)
 {
-	UBX_saved_t *current = UBX_saved + (UBX_write % UBX_SAVED_LEN);
-	UBX_nav_timeutc *nav_timeutc = (UBX_nav_timeutc *) UBX_payload;
+	UBX_ReceiveMessage(UBX_MSG_TIMEUTC, *((uint32_t *) UBX_payload));
+}
 
-	current->nano  = nav_timeutc->nano;
-	current->year  = nav_timeutc->year;
-	current->month = nav_timeutc->month;
-	current->day   = nav_timeutc->day;
-	current->hour  = nav_timeutc->hour;
-	current->min   = nav_timeutc->min;
-	current->sec   = nav_timeutc->sec;
+static void UBX_HandleAck(void)
+{
+	UBX_ack_ack *ack = (UBX_ack_ack *) UBX_payload;
 
-	UBX_ReceiveMessage(UBX_MSG_TIMEUTC, nav_timeutc->iTOW);
+	UBX_ack_clsID = ack->clsID;
+	UBX_ack_msgID = ack->msgID;
+	UBX_ack_received = UBX_msg_id + 1;
 }
 
 static void UBX_HandleMessage(void)
 {
-	if ((uint8_t) (UBX_read + UBX_SAVED_LEN) == UBX_write)
-	{
-		++UBX_read;
-	}
-
 	switch (UBX_msg_class)
 	{
 	case UBX_NAV:
+		if (!UBX_field_dest) break;
+
 		switch (UBX_msg_id)
 		{
 		case UBX_NAV_SOL:
@@ -1343,41 +1993,73 @@ static void UBX_HandleMessage(void)
 			break;
 		}
 		break;
+	case UBX_ACK:
+		switch (UBX_msg_id)
+		{
+		case UBX_ACK_NAK:
+		case UBX_ACK_ACK:
+			UBX_HandleAck();
+			break;
+		}
+		break;
 	}
 }
 
-void UBX_Init(void)
+static void UBX_ReceiveByte(
+	unsigned int ch)
 {
-	UBX_cfg_msg cfg_msg[] =
-	{
-		{UBX_NMEA, UBX_NMEA_GPGGA,  0},
-		{UBX_NMEA, UBX_NMEA_GPGLL,  0},
-		{UBX_NMEA, UBX_NMEA_GPGSA,  0},
-		{UBX_NMEA, UBX_NMEA_GPGSV,  0},
-		{UBX_NMEA, UBX_NMEA_GPRMC,  0},
-		{UBX_NMEA, UBX_NMEA_GPVTG,  0},
-		{UBX_NAV,  UBX_NAV_POSLLH,  1},
-		{UBX_NAV,  UBX_NAV_VELNED,  1},
-		{UBX_NAV,  UBX_NAV_TIMEUTC, 1}
-	};
+	// Called from the UART receive interrupt, so that frames are assembled
+	// and validated regardless of how long the main loop is blocked. It runs
+	// with interrupts disabled and holds up the audio interrupt, so no byte
+	// does more than a small, bounded amount of work. The heavier steps of
+	// a frame fall on different bytes: the decoder lookup on the message
+	// ID, the first field on the length, and epoch commits on the last 
+	// payload byte and the checksum.
+
+	UBX_epoch_timer = 0;
 
-	UBX_cfg_msg cfg_sol =
+	if (ch & UART_FRAME_ERROR)
 	{
-		.msgClass = UBX_NAV,
-		.msgID    = UBX_NAV_SOL,
-		.rate     = 1
-	};
+		++UBX_stats.frameErrors;
+	}
+	if (ch & UART_OVERRUN_ERROR)
+	{
+		++UBX_stats.overrunErrors;
+	}
+
+	if (UBX_HandleByte(ch))
+	{
+		UBX_CommitRaw();
+		UBX_HandleMessage();
+	}
+}
+
+static void UBX_InitPost(
+	uint8_t  msg_class,
+	uint8_t  msg_id,
+	uint16_t size,
+	void     *data)
+{
+	UBX_SendMessage(msg_class, msg_id, size, data);
 
-	UBX_cfg_msg cfg_pvt =
+	UBX_init_class   = msg_class;
+	UBX_init_id      = msg_id;
+	UBX_init_waiting = 1;
+
+	Timer_Set(UBX_TIMEOUT);
+}
+
+static void UBX_InitSend(void)
+{
+	uint8_t portID = 1; // UART 1
+
+	UBX_cfg_msg cfg_msg =
 	{
 		.msgClass = UBX_NAV,
-		.msgID    = UBX_NAV_PVT,
+		.msgID    = UBX_NAV_SOL,
 		.rate     = 1
 	};
 
-	size_t n = sizeof(cfg_msg) / sizeof(UBX_cfg_msg);
-	size_t i;
-
 	UBX_cfg_rate cfg_rate =
 	{
 		.measRate   = UBX_rate, // Measurement rate (ms)
@@ -1385,12 +2067,6 @@ void UBX_Init(void)
 		.timeRef    = 0         // UTC time
 	};
 
-	UBX_cfg_rst cfg_rst =
-	{
-		.navBbrMask = 0x0000,   // Hot start
-		.resetMode  = 0x09      // Controlled GPS start
-	};
-	
 	UBX_cfg_nav5 cfg_nav5 =
 	{
 		.mask       = 0x0001,   // Apply dynamic model settings
@@ -1403,55 +2079,72 @@ void UBX_Init(void)
 		.reserved0    = 0,      // Reserved
 		.txReady      = 0,      // no TX ready
 		.mode         = 0x08d0, // 8N1
-		.baudRate     = 38400,  // Baudrate in bits/second
+		.baudRate     = 0,      // Baudrate in bits/second
 		.inProtoMask  = 0x0001, // UBX protocol
 		.outProtoMask = 0x0001, // UBX protocol
 		.flags        = 0,      // Flags bit mask
 		.reserved5    = 0       // Reserved, set to 0
 	};
 
-	do
+	switch (UBX_init_step)
 	{
-		uart_init(51); // 9600 baud
+	case UBX_INIT_PROBE:
+		UBX_SetBaudRate(UBX_init_index);
+		UBX_InitPost(UBX_CFG, UBX_CFG_PRT, sizeof(portID), &portID);
+		break;
+	case UBX_INIT_SWITCH:
+		cfg_prt.baudRate = pgm_read_dword(&UBX_baud_rates[UBX_init_baud].baudRate);
 
 		UBX_SendMessage(UBX_CFG, UBX_CFG_PRT, sizeof(cfg_prt), &cfg_prt);
 
-		// NOTE: We don't wait for ACK here since some FlySights will already be
-		//       set to 38400 baud.
+		// NOTE: We don't wait for ACK here since the receiver may switch
+		//       rates before it is sent.
 
 		while (!uart_tx_empty());
 
-		uart_init(12); // 38400 baud
-
-		_delay_ms(10); // wait for GPS UART to reset
-
-		UBX_SendMessage(UBX_CFG, UBX_CFG_PRT, sizeof(cfg_prt), &cfg_prt);
-	}
-	while (!UBX_WaitForAck(UBX_CFG, UBX_CFG_PRT, UBX_TIMEOUT));
-
-	#define SEND_MESSAGE(c,m,d) \
-		do { \
-			UBX_SendMessage(c,m,sizeof(d),&d); \
-		} while (!UBX_WaitForAck(c,m,UBX_TIMEOUT));
-
-	for (i = 0; i < n; ++i)
-	{
-		SEND_MESSAGE(UBX_CFG, UBX_CFG_MSG, cfg_msg[i]);
+		UBX_SetBaudRate(UBX_init_baud);
+		UBX_InitPost(UBX_CFG, UBX_CFG_PRT, sizeof(cfg_prt), &cfg_prt);
+		break;
+	case UBX_INIT_NMEA:
+		cfg_msg.msgClass = UBX_NMEA;
+		cfg_msg.msgID    = pgm_read_byte(&UBX_init_nmea[UBX_init_index]);
+		cfg_msg.rate     = 0;
+		UBX_InitPost(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_msg), &cfg_msg);
+		break;
+	case UBX_INIT_PVT:
+		cfg_msg.msgID = UBX_NAV_PVT;
+		UBX_InitPost(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_msg), &cfg_msg);
+		break;
+	case UBX_INIT_SOL:
+		UBX_InitPost(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_msg), &cfg_msg);
+		break;
+	case UBX_INIT_SOL_OFF:
+		cfg_msg.rate = 0;
+		UBX_InitPost(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_msg), &cfg_msg);
+		break;
+	case UBX_INIT_NAV:
+		cfg_msg.msgID = pgm_read_byte(&UBX_init_nav[UBX_init_index]);
+		cfg_msg.rate  = UBX_pvt_only ? 0 : 1;
+		UBX_InitPost(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_msg), &cfg_msg);
+		break;
+	case UBX_INIT_RATE:
+		UBX_InitPost(UBX_CFG, UBX_CFG_RATE, sizeof(cfg_rate), &cfg_rate);
+		break;
+	case UBX_INIT_NAV5:
+		UBX_InitPost(UBX_CFG, UBX_CFG_NAV5, sizeof(cfg_nav5), &cfg_nav5);
+		break;
 	}
+}
 
-	while (1)
+static void UBX_InitFinish(void)
+{
+	UBX_cfg_rst cfg_rst =
 	{
-		UBX_SendMessage(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_sol), &cfg_sol);
-		if (UBX_WaitForAck(UBX_CFG, UBX_CFG_MSG, UBX_TIMEOUT)) break;
+		.navBbrMask = 0x0000,   // Hot start
+		.resetMode  = 0x09      // Controlled GPS start
+	};
 
-		UBX_SendMessage(UBX_CFG, UBX_CFG_MSG, sizeof(cfg_pvt), &cfg_pvt);
-		if (UBX_WaitForAck(UBX_CFG, UBX_CFG_MSG, UBX_TIMEOUT)) break;
-	}
-	
-	SEND_MESSAGE(UBX_CFG, UBX_CFG_RATE, cfg_rate);
-	SEND_MESSAGE(UBX_CFG, UBX_CFG_NAV5, cfg_nav5);
-	
-	#undef SEND_MESSAGE
+	uint8_t i;
 
 	UBX_SendMessage(UBX_CFG, UBX_CFG_RST, sizeof(cfg_rst), &cfg_rst);
 
@@ -1469,97 +2162,565 @@ void UBX_Init(void)
 	}
 }
 
-void UBX_Task(void)
+static void UBX_InitGo(
+	uint8_t step)
+{
+	UBX_init_step  = step;
+	UBX_init_index = 0;
+}
+
+static void UBX_InitNext(
+	uint8_t acked)
+{
+	switch (UBX_init_step)
+	{
+	case UBX_INIT_PROBE:
+		// Find the rate the receiver is currently using
+		if (acked)
+		{
+			UBX_InitGo(UBX_INIT_SWITCH);
+		}
+		else if (++UBX_init_index == UBX_NUM_BAUD_RATES)
+		{
+			UBX_init_index = 0;
+		}
+		break;
+	case UBX_INIT_SWITCH:
+		// Ask the receiver to switch to the fastest rate in the ladder. If
+		// the switch is not acknowledged at the new rate, fall back to the
+		// next slower one.
+		if (acked)
+		{
+			UBX_baud = pgm_read_dword(&UBX_baud_rates[UBX_init_baud].baudRate);
+			UBX_InitGo(UBX_INIT_NMEA);
+		}
+		else
+		{
+			UBX_init_baud = (UBX_init_baud + 1) % UBX_NUM_BAUD_LADDER;
+			UBX_InitGo(UBX_INIT_PROBE);
+		}
+		break;
+	case UBX_INIT_NMEA:
+		if (acked && ++UBX_init_index == sizeof(UBX_init_nmea))
+		{
+			UBX_InitGo(UBX_INIT_PVT);
+		}
+		break;
+	case UBX_INIT_PVT:
+		// Prefer NAV-PVT, which carries the whole epoch in a single message. 
+		// Receivers without it (e.g., NEO-6) fall back to NAV-SOL combined 
+		// with NAV-POSLLH, NAV-VELNED and NAV-TIMEUTC.
+		if (acked)
+		{
+			UBX_pvt_only = 1;
+			UBX_InitGo(UBX_INIT_SOL_OFF);
+		}
+		else
+		{
+			UBX_InitGo(UBX_INIT_SOL);
+		}
+		break;
+	case UBX_INIT_SOL:
+		UBX_InitGo(acked ? UBX_INIT_NAV : UBX_INIT_PVT);
+		break;
+	case UBX_INIT_SOL_OFF:
+		if (acked)
+		{
+			UBX_InitGo(UBX_INIT_NAV);
+		}
+		break;
+	case UBX_INIT_NAV:
+		if (acked && ++UBX_init_index == sizeof(UBX_init_nav))
+		{
+			UBX_InitGo(UBX_INIT_RATE);
+		}
+		break;
+	case UBX_INIT_RATE:
+		if (acked)
+		{
+			UBX_InitGo(UBX_INIT_NAV5);
+		}
+		break;
+	case UBX_INIT_NAV5:
+		if (acked)
+		{
+			UBX_InitFinish();
+			UBX_InitGo(UBX_INIT_DONE);
+		}
+		break;
+	}
+}
+
+void UBX_InitStart(void)
+{
+	uart_set_rx_handler(UBX_ReceiveByte);
+
+	UBX_init_baud    = 0;
+	UBX_init_waiting = 0;
+	UBX_InitGo(UBX_INIT_PROBE);
+}
+
+uint8_t UBX_InitTask(void)
+{
+	uint8_t received;
+
+	if (UBX_init_step == UBX_INIT_DONE)
+	{
+		return 1;
+	}
+
+	if (!UBX_init_waiting)
+	{
+		UBX_InitSend();
+	}
+	else if ((received = UBX_ack_received))
+	{
+		if (UBX_ack_clsID == UBX_init_class &&
+		    UBX_ack_msgID == UBX_init_id)
+		{
+			UBX_init_waiting = 0;
+			UBX_InitNext(received == UBX_ACK_ACK + 1);
+		}
+		else
+		{
+			UBX_ack_received = 0;
+		}
+	}
+	else if (Timer_Get() == 0)
+	{
+		UBX_init_waiting = 0;
+		UBX_InitNext(0);
+	}
+
+	return UBX_init_step == UBX_INIT_DONE;
+}
+
+void UBX_Init(void)
+{
+	UBX_InitStart();
+	while (!UBX_InitTask());
+}
+
+static char *UBX_WriteField(
+	char    *ptr,
+	uint8_t valid,
+	int32_t val,
+	int8_t  dec,
+	char    delimiter)
+{
+	// Fields from missing messages are left empty
+
+	if (valid)
+	{
+		return Log_WriteInt32ToBuf(ptr, val, dec, 1, delimiter);
+	}
+
+	*(--ptr) = delimiter;
+	return ptr;
+}
+
+#ifdef LATENCY_STATS
+static void UBX_WriteLatency(void)
+{
+	Latency_stat_t stats[LATENCY_STAGES];
+	char    *ptr;
+	int8_t  i;
+
+	Latency_GetStats(stats);
+
+	ptr = UBX_buffer.buffer + sizeof(UBX_buffer.buffer);
+	*(--ptr) = 0;
+
+	*(--ptr) = '\n';
+	ptr = Log_WriteInt32ToBuf(ptr, stats[LATENCY_TOTAL].count, 0, 0, '\r');
+	ptr = Log_WriteInt32ToBuf(ptr, stats[LATENCY_PROC].count,  0, 0, ',');
+
+	for (i = LATENCY_STAGES - 1; i >= 0; --i)
+	{
+		ptr = Log_WriteInt32ToBuf(ptr, stats[i].max, 0, 0, ',');
+		ptr = Log_WriteInt32ToBuf(ptr, stats[i].count ? stats[i].sum / stats[i].count : 0, 0, 0, ',');
+		ptr = Log_WriteInt32ToBuf(ptr, stats[i].min, 0, 0, ',');
+	}
+
+	Log_WriteStats(UBX_stats_header, ptr);
+}
+#endif
+
+static void UBX_WriteStats(void)
+{
+	UBX_stats_t stats;
+	char *ptr;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		UBX_stats.sdWrites = disk_write_count;
+		stats = UBX_stats;
+	}
+
+	ptr = UBX_buffer.buffer + sizeof(UBX_buffer.buffer);
+	*(--ptr) = 0;
+
+#ifdef LATENCY_STATS
+	// The latency columns continue the row, but do not fit in the buffer
+	// with it
+	ptr = Log_WriteInt32ToBuf(ptr, stats.upTime,           0, 0, ',');
+#else
+	*(--ptr) = '\n';
+	ptr = Log_WriteInt32ToBuf(ptr, stats.upTime,           0, 0, '\r');
+#endif
+	ptr = Log_WriteInt32ToBuf(ptr, stats.holdTime,         0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.sdWrites,         0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.syncs,            0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.epochs,           0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.incompleteEpochs, 0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.rawOverflows,     0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.ringOverflows,    0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.lengthErrors,     0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.checksumErrors,   0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.overrunErrors,    0, 0, ',');
+	ptr = Log_WriteInt32ToBuf(ptr, stats.frameErrors,      0, 0, ',');
+
+	Log_WriteStats(UBX_stats_header, ptr);
+
+#ifdef LATENCY_STATS
+	UBX_WriteLatency();
+#endif
+}
+
+static char *UBX_FormatCSVRecord(
+	UBX_saved_t *current)
 {
 #ifdef STACK_PAINTING
 	static int32_t stack_count = 4096;
 	int32_t temp;
 #endif
-	
-	unsigned int ch;
 
-	UBX_saved_t *current;
 	char *ptr;
+	uint8_t sol, pos, vel;
+
+	sol = current->valid & UBX_MSG_SOL;
+	pos = current->valid & UBX_MSG_POSLLH;
+	vel = current->valid & UBX_MSG_VELNED;
+
+	ptr = UBX_buffer.buffer + sizeof(UBX_buffer.buffer);
+	*(--ptr) = 0;
+
+	*(--ptr) = '\n';
+#ifdef STACK_PAINTING
+	temp = Stack_Count();
+	if (temp < stack_count)
+	{
+		stack_count = temp;
+	}
+
+	ptr = Log_WriteInt32ToBuf(ptr, stack_count,      0, 0, '\r');
+	ptr = UBX_WriteField(ptr, sol, current->numSV,   0, ',');
+#else
+	ptr = UBX_WriteField(ptr, sol, current->numSV,   0, '\r');
+#endif
+	ptr = UBX_WriteField(ptr, sol, current->gpsFix,  0, ',');
+	ptr = UBX_WriteField(ptr, vel, current->cAcc,    5, ',');
+	ptr = UBX_WriteField(ptr, vel, current->heading, 5, ',');
+	ptr = UBX_WriteField(ptr, vel, current->sAcc,    2, ',');
+	ptr = UBX_WriteField(ptr, pos, current->vAcc,    3, ',');
+	ptr = UBX_WriteField(ptr, pos, current->hAcc,    3, ',');
+	ptr = UBX_WriteField(ptr, vel, current->velD,    2, ',');
+	ptr = UBX_WriteField(ptr, vel, current->velE,    2, ',');
+	ptr = UBX_WriteField(ptr, vel, current->velN,    2, ',');
+	ptr = UBX_WriteField(ptr, pos, current->hMSL,    3, ',');
+	ptr = UBX_WriteField(ptr, pos, current->lon,     7, ',');
+	ptr = UBX_WriteField(ptr, pos, current->lat,     7, ',');
+	*(--ptr) = ',';
+	if (current->valid & UBX_MSG_TIMEUTC)
+	{
+		ptr = Log_WriteInt32ToBuf(ptr, (current->nano + 5000000) / 10000000, 2, 0, 'Z');
+		ptr = Log_WriteInt32ToBuf(ptr, current->sec,     2, 0, '.');
+		ptr = Log_WriteInt32ToBuf(ptr, current->min,     2, 0, ':');
+		ptr = Log_WriteInt32ToBuf(ptr, current->hour,    2, 0, ':');
+		ptr = Log_WriteInt32ToBuf(ptr, current->day,     2, 0, 'T');
+		ptr = Log_WriteInt32ToBuf(ptr, current->month,   2, 0, '-');
+		ptr = Log_WriteInt32ToBuf(ptr, current->year,    4, 0, '-');
+	}
+
+	return ptr;
+}
+
+static void UBX_WriteCSVRecord(
+	UBX_saved_t *current)
+{
+	char *ptr = UBX_FormatCSVRecord(current);
+
+	Log_Write(ptr, UBX_buffer.buffer + sizeof(UBX_buffer.buffer) - 1 - ptr);
+}
+
+static int16_t UBX_Clamp16(
+	int32_t val)
+{
+	return val < INT16_MIN ? INT16_MIN : (val > INT16_MAX ? INT16_MAX : val);
+}
+
+static uint8_t UBX_Scale8(
+	uint32_t val,
+	uint32_t scale)
+{
+	// Compared before rounding, so that the receiver's "unknown" accuracy
+	// (close to UINT32_MAX) can't wrap around to a small value
+
+	if (val > (uint32_t) UINT8_MAX * scale)
+	{
+		return UINT8_MAX;
+	}
+
+	return (val + scale / 2) / scale;
+}
+
+static void UBX_WriteTrackRecord(
+	UBX_saved_t *current)
+{
+	Track_key_t    *key = (Track_key_t *) UBX_buffer.buffer;
+	Track_record_t *rec;
+	int32_t dLat = 0, dLon = 0, dHMSL = 0;
+	uint8_t len = 0;
 
-	while (!((ch = uart_getc()) & UART_NO_DATA))
+	// Positions are stored as changes from the previous position, with a 
+	// key record whenever the change doesn't fit
+
+	if (current->valid & UBX_MSG_POSLLH)
 	{
-		if (UBX_HandleByte(ch))
+		dLat  = current->lat  - UBX_track_lat;
+		dLon  = current->lon  - UBX_track_lon;
+		dHMSL = current->hMSL - UBX_track_hMSL;
+
+		if (UBX_track_key ||
+		    dLat  != (int16_t) dLat ||
+		    dLon  != (int16_t) dLon ||
+		    dHMSL != (int16_t) dHMSL)
 		{
-			UBX_HandleMessage();
+			memset(key, 0, sizeof(Track_key_t));
+			key->flags = TRACK_KEY;
+			key->lat   = current->lat;
+			key->lon   = current->lon;
+			key->hMSL  = current->hMSL;
+
+			len = sizeof(Track_key_t);
+			dLat = dLon = dHMSL = 0;
+			UBX_track_key = 0;
 		}
+
+		UBX_track_lat  = current->lat;
+		UBX_track_lon  = current->lon;
+		UBX_track_hMSL = current->hMSL;
+	}
+
+	rec = (Track_record_t *) (UBX_buffer.buffer + len);
+	len += sizeof(Track_record_t);
+
+	// UBX_MSG_* use the same bits as TRACK_*
+	rec->flags   = current->valid & UBX_MSG_ALL;
+	rec->gpsFix  = current->gpsFix;
+	rec->numSV   = current->numSV;
+
+	if (current->valid & UBX_MSG_TIMEUTC)
+	{
+		rec->csec = (current->nano + 5000000) / 10000000;
+		rec->sec  = mk_gmtime(
+			current->year, current->month, current->day,
+			current->hour, current->min, current->sec) - UBX_track_time;
+	}
+	else
+	{
+		rec->csec = 0;
+		rec->sec  = 0;
+	}
+
+	rec->dLat    = dLat;
+	rec->dLon    = dLon;
+	rec->dHMSL   = dHMSL;
+
+	rec->velN    = UBX_Clamp16(current->velN);
+	rec->velE    = UBX_Clamp16(current->velE);
+	rec->velD    = UBX_Clamp16(current->velD);
+	rec->heading = (current->heading + TRACK_HEAD_SCALE / 2) / TRACK_HEAD_SCALE;
+
+	rec->hAcc    = UBX_Scale8(current->hAcc, TRACK_HACC_SCALE);
+	rec->vAcc    = UBX_Scale8(current->vAcc, TRACK_VACC_SCALE);
+	rec->sAcc    = UBX_Scale8(current->sAcc, TRACK_SACC_SCALE);
+	rec->cAcc    = UBX_Scale8(current->cAcc, TRACK_CACC_SCALE);
+
+	Log_Write(UBX_buffer.buffer, len);
+}
+
+static uint8_t UBX_SyncDue(void)
+{
+	uint16_t timer;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		timer = UBX_sync_timer;
+	}
+
+	return UBX_sync_now || 
+	       UBX_sync_count >= UBX_sync_rows ||
+	       (UBX_sync_int && timer >= UBX_sync_int);
+}
+
+void UBX_Task(void)
+{
+	UBX_saved_t *current;
+	uint16_t raw_write, raw_len;
+	uint8_t wrote = 0;
+
+	while (UBX_proc != UBX_write)
+	{
+		UBX_ProcessEpoch(UBX_saved + (UBX_proc % UBX_SAVED_LEN));
+		++UBX_proc;
+	}
+
+	// Records without a 3D fix, or from before the log was opened, are not
+	// logged
+
+	while (UBX_read != UBX_proc &&
+	       (!Log_IsInitialized() || Log_track == LOG_TRACK_NONE ||
+	        UBX_saved[UBX_read % UBX_SAVED_LEN].gpsFix != 0x03))
+	{
+		++UBX_read;
 	}
 	
 	switch (UBX_state)
 	{
 	case st_idle:
-		if (Tone_CanWrite() && disk_is_ready() && UBX_read != UBX_write)
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 		{
-			current = UBX_saved + (UBX_read % UBX_SAVED_LEN);
+			raw_write = UBX_raw_write;
+		}
+
+		if (Tone_CanWrite() && disk_is_ready() && UBX_raw_read != raw_write)
+		{
+			// Raw frames are written up to the end of the buffer, and any
+			// remainder on the next pass
+
+			raw_len = MIN((uint16_t) (raw_write - UBX_raw_read), 
+				UBX_RAW_LEN - UBX_raw_read % UBX_RAW_LEN);
 
 			Power_Hold();
+			Log_WriteRaw(UBX_raw + UBX_raw_read % UBX_RAW_LEN, raw_len);
 
-			ptr = UBX_buffer.buffer + sizeof(UBX_buffer.buffer);
-			*(--ptr) = 0;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				UBX_raw_read += raw_len;
+			}
 
-			*(--ptr) = '\n';
-#ifdef STACK_PAINTING
-			temp = Stack_Count();
-			if (temp < stack_count)
+			UBX_sync_files |= UBX_SYNC_RAW;
+			if (Log_track == LOG_TRACK_NONE)
 			{
-				stack_count = temp;
+				++UBX_sync_count;
+			}
+
+			wrote = 1;
+		}
+		else if (Tone_CanWrite() && disk_is_ready() && UBX_read != UBX_proc)
+		{
+			current = UBX_saved + (UBX_read % UBX_SAVED_LEN);
+
+			Power_Hold();
+
+			if (Log_track == LOG_TRACK_BIN)
+			{
+				UBX_WriteTrackRecord(current);
+			}
+			else
+			{
+				UBX_WriteCSVRecord(current);
 			}
 
-			ptr = Log_WriteInt32ToBuf(ptr, stack_count,      0, 0, '\r');
-			ptr = Log_WriteInt32ToBuf(ptr, current->numSV,   0, 0, ',');
-#else
-			ptr = Log_WriteInt32ToBuf(ptr, current->numSV,   0, 0, '\r');
-#endif
-			ptr = Log_WriteInt32ToBuf(ptr, current->gpsFix,  0, 0, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->cAcc,    5, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->heading, 5, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->sAcc,    2, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->vAcc,    3, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->hAcc,    3, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->velD,    2, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->velE,    2, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->velN,    2, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->hMSL,    3, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->lon,     7, 1, ',');
-			ptr = Log_WriteInt32ToBuf(ptr, current->lat,     7, 1, ',');
-			*(--ptr) = ',';
-			ptr = Log_WriteInt32ToBuf(ptr, (current->nano + 5000000) / 10000000, 2, 0, 'Z');
-			ptr = Log_WriteInt32ToBuf(ptr, current->sec,     2, 0, '.');
-			ptr = Log_WriteInt32ToBuf(ptr, current->min,     2, 0, ':');
-			ptr = Log_WriteInt32ToBuf(ptr, current->hour,    2, 0, ':');
-			ptr = Log_WriteInt32ToBuf(ptr, current->day,     2, 0, 'T');
-			ptr = Log_WriteInt32ToBuf(ptr, current->month,   2, 0, '-');
-			ptr = Log_WriteInt32ToBuf(ptr, current->year,    4, 0, '-');
 			++UBX_read;
 
-			f_puts(ptr, &Main_file);
+			UBX_sync_files |= UBX_SYNC_TRACK;
+			++UBX_sync_count;
+
+			wrote = 1;
+		}
+
+		// Rows are only written to the card when a sector fills up or the 
+		// file is synced. Between syncs, power is released, so switching
+		// off loses at most the rows written since the last sync.
+
+		if (UBX_sync_files && UBX_SyncDue())
+		{
+			// Statistics are added to a sync that is already due, rather
+			// than saved on their own
+
+			if (UBX_stats_due)
+			{
+				UBX_sync_files |= UBX_SYNC_STATS;
+				UBX_stats_due = 0;
+			}
+
+			Power_Hold();
 			UBX_state = st_flush_1;
 		}
+		else if (wrote)
+		{
+			Power_Release();
+		}
 		break;
 	case st_flush_1:
 		if (Tone_CanWrite() && disk_is_ready())
 		{
-			f_sync_1(&Main_file);
+			if (UBX_sync_files & UBX_SYNC_TRACK)
+			{
+				UBX_flush_file = &Main_file;
+				UBX_sync_files &= ~UBX_SYNC_TRACK;
+
+				Log_Drain();
+			}
+			else if (UBX_sync_files & UBX_SYNC_RAW)
+			{
+				UBX_flush_file = &Log_raw_file;
+				UBX_sync_files &= ~UBX_SYNC_RAW;
+			}
+			else
+			{
+				UBX_flush_file = &Log_stats_file;
+				UBX_sync_files &= ~UBX_SYNC_STATS;
+
+				UBX_WriteStats();
+			}
+
+			f_sync_1(UBX_flush_file);
 			UBX_state = st_flush_2;
 		}
 		break;
 	case st_flush_2:
 		if (Tone_CanWrite() && disk_is_ready())
 		{
-			f_sync_2(&Main_file);
+			f_sync_2(UBX_flush_file);
 			UBX_state = st_flush_3;
 		}
 		break;
 	case st_flush_3:
 		if (Tone_CanWrite() && disk_is_ready())
 		{
-			f_sync_3(&Main_file);
-			Power_Release();
-			UBX_state = st_idle;
+			f_sync_3(UBX_flush_file);
+
+			if (UBX_sync_files)
+			{
+				UBX_state = st_flush_1;
+			}
+			else
+			{
+				ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+				{
+					UBX_sync_timer = 0;
+				}
+
+				UBX_sync_count = 0;
+				UBX_sync_now = 0;
+				++UBX_stats.syncs;
+
+				Power_Release();
+				UBX_state = st_idle;
+			}
 		}
 		break;
 	}
@@ -1697,3 +2858,26 @@ void UBX_Task(void)
 		}
 	}
 }
+
+char *UBX_TelemetryTask(void)
+{
+	UBX_saved_t *current;
+	char *ptr;
+
+	while (UBX_proc != UBX_write)
+	{
+		UBX_ProcessEpoch(UBX_saved + (UBX_proc % UBX_SAVED_LEN));
+		++UBX_proc;
+	}
+
+	if (UBX_read == UBX_proc) return 0;
+
+	// Every epoch is reported, with or without a fix, as a row in the same
+	// format as the CSV log
+
+	current = UBX_saved + (UBX_read % UBX_SAVED_LEN);
+	ptr = UBX_FormatCSVRecord(current);
+	++UBX_read;
+
+	return ptr;
+}
@@ -62,6 +62,24 @@ typedef struct
 }
 UBX_speech_t;
 
+// Counters above holdTime are cleared once the GPS baud rate is settled
+typedef struct
+{
+	uint32_t frameErrors;      // UART framing errors
+	uint32_t overrunErrors;    // UART overrun errors
+	uint32_t checksumErrors;   // Frames with a bad checksum
+	uint32_t lengthErrors;     // Frames with an oversize length
+	uint32_t ringOverflows;    // Messages dropped because the ring was full
+	uint32_t rawOverflows;     // Raw frames dropped because the buffer was full
+	uint32_t incompleteEpochs; // Epochs missing at least one message
+	uint32_t epochs;           // Completed epochs
+	uint32_t syncs;            // Log syncs
+	uint32_t sdWrites;         // Sectors written to the SD card
+	uint32_t holdTime;         // Time with power held    (ms)
+	uint32_t upTime;           // Time since power on     (ms)
+}
+UBX_stats_t;
+
 typedef struct
 {
 	char buffer[UBX_BUFFER_LEN - UBX_FILENAME_LEN];
@@ -71,6 +89,8 @@ UBX_buffer_t;
 
 extern uint8_t   UBX_model;
 extern uint16_t  UBX_rate;
+extern uint16_t  UBX_tone_int;
+extern uint16_t  UBX_lead;
 extern uint8_t   UBX_mode;
 extern int32_t   UBX_min;
 extern int32_t   UBX_max;
@@ -87,6 +107,13 @@ extern uint8_t   UBX_use_sas;
 extern int32_t   UBX_threshold;
 extern int32_t   UBX_hThreshold;
 
+extern uint8_t   UBX_sync_rows;
+extern uint16_t  UBX_sync_int;
+extern uint8_t   UBX_sync_phase;
+
+extern uint8_t   UBX_telemetry;
+extern const char UBX_header[];
+
 extern UBX_alarm_t UBX_alarms[UBX_MAX_ALARMS];
 extern uint8_t   UBX_num_alarms;
 extern int32_t   UBX_alarm_window_above;
@@ -109,8 +136,15 @@ extern uint8_t    UBX_num_windows;
 
 extern int32_t    UBX_dz_elev;
 
+extern uint32_t   UBX_baud;
+
+extern volatile UBX_stats_t UBX_stats;
+
 void UBX_Init(void);
+void UBX_InitStart(void);
+uint8_t UBX_InitTask(void);
 void UBX_Task(void);
 void UBX_Update(void);
+char *UBX_TelemetryTask(void);
 
 #endif
@@ -24,6 +24,7 @@
 #include "Main.h"
 #include "UsbInterface.h"
 #include "uart.h"
+#include "UBX.h"
 
 USB_ClassInfo_MS_Device_t Disk_MS_Interface =
 {
@@ -34,13 +35,13 @@ USB_ClassInfo_MS_Device_t Disk_MS_Interface =
 		{
 			.Address           = MASS_STORAGE_IN_EPADDR,
 			.Size              = MASS_STORAGE_IO_EPSIZE,
-			.Banks             = 1,
+			.Banks             = 2,
 		},
 		.DataOUTEndpoint       =
 		{
 			.Address           = MASS_STORAGE_OUT_EPADDR,
 			.Size              = MASS_STORAGE_IO_EPSIZE,
-			.Banks             = 1,
+			.Banks             = 2,
 		},
 		.TotalLUNs             = TOTAL_LUNS,
 	},
@@ -75,6 +76,10 @@ USB_ClassInfo_CDC_Device_t UBX_CDC_Interface =
 #endif
 
 
+#ifdef USE_TELEMETRY_INTERFACE
+static bool USB_send_header = false;
+#endif
+
 void EVENT_USB_Device_Connect(void)
 {
 
@@ -101,6 +106,15 @@ void EVENT_USB_Device_ControlRequest(void)
 #endif
 }
 
+#ifdef USE_TELEMETRY_INTERFACE
+void EVENT_CDC_Device_LineEncodingChanged(
+	USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	// A terminal has opened the port
+	USB_send_header = true;
+}
+#endif
+
 bool CALLBACK_MS_Device_SCSICommandReceived(
 	USB_ClassInfo_MS_Device_t* const MSInterfaceInfo)
 {
@@ -115,7 +129,34 @@ bool CALLBACK_MS_Device_SCSICommandReceived(
 
 void USBInterfaceTask(void)
 {
-#ifdef USE_SERIAL_INTERFACE
+#if defined(USE_TELEMETRY_INTERFACE)
+	const char *hdr;
+	char *row;
+	char ch;
+
+	// Decoded epochs out, as CSV rows like those in the log
+	if (USB_send_header)
+	{
+		hdr = UBX_header;
+		while ((ch = pgm_read_byte(hdr++)))
+		{
+			CDC_Device_SendByte(&UBX_CDC_Interface, ch);
+		}
+
+		USB_send_header = false;
+	}
+
+	if ((row = UBX_TelemetryTask()) != 0)
+	{
+		CDC_Device_SendString(&UBX_CDC_Interface, row);
+	}
+
+	// Input from the host is ignored
+	CDC_Device_ReceiveByte(&UBX_CDC_Interface);
+
+	// Pump LUFA for both interfaces
+	CDC_Device_USBTask(&UBX_CDC_Interface);
+#elif defined(USE_SERIAL_INTERFACE)
 	uint16_t ch;
 	
 	// Pipe UART in -> CDC out
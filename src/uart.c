@@ -246,6 +246,7 @@ static volatile unsigned char UART_TxTail;
 static volatile unsigned char UART_RxHead;
 static volatile unsigned char UART_RxTail;
 static volatile unsigned char UART_LastRxError;
+static void (*UART_RxHandler)(unsigned int data);
 
 #if defined( ATMEGA_USART1 )
 static volatile unsigned char UART1_TxBuf[UART_TX_BUFFER_SIZE];
@@ -285,8 +286,16 @@ Purpose:  called when the UART has received a character
 #elif defined ( ATMEGA_UART )
     lastRxError = (usr & (_BV(FE)|_BV(DOR)) );
 #elif defined ( AT90USB_UART )
-    lastRxError = (usr & (_BV(FE1)|_BV(DOR1)) );
+    lastRxError = 0;
+    if ( usr & _BV(FE1) )  lastRxError |= UART_FRAME_ERROR >> 8;
+    if ( usr & _BV(DOR1) ) lastRxError |= UART_OVERRUN_ERROR >> 8;
 #endif
+
+    if ( UART_RxHandler ) {
+        /* pass data straight to handler, bypassing the ringbuffer */
+        UART_RxHandler( (lastRxError << 8) | data );
+        return;
+    }
         
     /* calculate buffer index */ 
     tmphead = ( UART_RxHead + 1) & UART_RX_BUFFER_MASK;
@@ -406,6 +415,10 @@ void uart_init(unsigned int baudrate)
    		UART0_STATUS = (1<<U2X1);  //Enable 2x speed 
    		baudrate &= ~0x8000;
    	}
+    else
+    {
+        UART0_STATUS = 0;          //Disable 2x speed
+    }
     UBRR1H = (unsigned char)(baudrate>>8);
     UBRR1L = (unsigned char) baudrate;
 
@@ -420,6 +433,18 @@ void uart_init(unsigned int baudrate)
 }/* uart_init */
 
 
+/*************************************************************************
+Function: uart_set_rx_handler()
+Purpose:  set function called from the receive interrupt for each byte
+Input:    handler, or 0 to store received bytes in the ringbuffer
+Returns:  none
+**************************************************************************/
+void uart_set_rx_handler(void (*handler)(unsigned int data))
+{
+    UART_RxHandler = handler;
+}/* uart_set_rx_handler */
+
+
 /*************************************************************************
 Function: uart_getc()
 Purpose:  return byte from ringbuffer  
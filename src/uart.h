@@ -105,6 +105,22 @@ LICENSE:
 extern void uart_init(unsigned int baudrate);
 
 
+/**
+   @brief   Handle received bytes in the receive interrupt
+   
+   When a handler is set, each received byte is passed to it from the 
+   receive interrupt instead of being stored in the ringbuffer. The lower 
+   byte holds the received character and the higher byte the receive 
+   status, as returned by uart_getc(). The handler runs with interrupts 
+   disabled, so it must be short: while it runs, every other interrupt 
+   waits.
+   
+   @param   handler function to call, or 0 to use the ringbuffer
+   @return  none
+*/
+extern void uart_set_rx_handler(void (*handler)(unsigned int data));
+
+
 /**
  *  @brief   Get received byte from ringbuffer
  *
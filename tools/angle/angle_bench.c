@@ -0,0 +1,150 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Counts AVR cycles for one dive angle with Angle_Atan2 and with the
+// floating point atan2 it replaced, over velocities from level flight to
+// a vertical dive. Built for an ATmega644, which has the same AVR core as
+// the AT90USB646, and run under simavr. Results are printed on the simavr
+// console.
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <stdint.h>
+
+#include "avr_mcu_section.h"
+
+#include "Angle.h"
+#include "angle_ref.h"
+
+AVR_MCU(F_CPU, "atmega644");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+// Down and ground speed pairs (cm/s)
+static const int16_t Bench_velocities[][2] PROGMEM =
+{
+	{     0, 1500 }, {   300, 1200 }, {  1000, 1000 }, {  2500,  800 },
+	{  5500,  200 }, {  7000,    0 }, {  -150, 2000 }, { 32767, 1234 }
+};
+
+#define NUM_VELOCITIES (sizeof(Bench_velocities) / sizeof(Bench_velocities[0]))
+
+static volatile int32_t Bench_sink;
+
+static void Bench_WriteString(
+	const char *str)
+{
+	char ch;
+
+	while ((ch = pgm_read_byte(str++)) != 0)
+	{
+		GPIOR0 = ch;
+	}
+}
+
+static void Bench_WriteNumber(
+	uint32_t val)
+{
+	char buf[11];
+	char *ptr = buf + sizeof(buf);
+
+	*--ptr = 0;
+	do
+	{
+		*--ptr = '0' + val % 10;
+		val /= 10;
+	}
+	while (val);
+
+	while (*ptr)
+	{
+		GPIOR0 = *ptr++;
+	}
+}
+
+static inline void Bench_Start(void)
+{
+	TCCR1A = 0;
+	TCCR1B = (1 << CS10);
+	TCNT1  = 0;
+}
+
+static inline uint16_t Bench_Stop(void)
+{
+	return TCNT1;
+}
+
+int main(void)
+{
+	uint32_t ref_total = 0, new_total = 0;
+	uint16_t ref, now;
+	uint8_t i;
+
+	for (i = 0; i < NUM_VELOCITIES; ++i)
+	{
+		int16_t velD   = pgm_read_word(&Bench_velocities[i][0]);
+		int16_t gSpeed = pgm_read_word(&Bench_velocities[i][1]);
+
+		Bench_Start();
+		Bench_sink = Ref_DiveAngle(velD, gSpeed);
+		ref = Bench_Stop();
+
+		Bench_Start();
+		Bench_sink = Angle_Atan2(velD, gSpeed);
+		now = Bench_Stop();
+
+		ref_total += ref;
+		new_total += now;
+
+		if (velD < 0)
+		{
+			Bench_WriteString(PSTR("velD -"));
+			Bench_WriteNumber(-velD);
+		}
+		else
+		{
+			Bench_WriteString(PSTR("velD "));
+			Bench_WriteNumber(velD);
+		}
+		Bench_WriteString(PSTR(", gSpeed "));
+		Bench_WriteNumber(gSpeed);
+		Bench_WriteString(PSTR(": atan2 "));
+		Bench_WriteNumber(ref);
+		Bench_WriteString(PSTR(" cycles, Angle_Atan2 "));
+		Bench_WriteNumber(now);
+		Bench_WriteString(PSTR(" cycles\n"));
+	}
+
+	Bench_WriteString(PSTR("Mean: atan2 "));
+	Bench_WriteNumber(ref_total / NUM_VELOCITIES);
+	Bench_WriteString(PSTR(" cycles, Angle_Atan2 "));
+	Bench_WriteNumber(new_total / NUM_VELOCITIES);
+	Bench_WriteString(PSTR(" cycles\n"));
+
+	// Stop the simulation
+	cli();
+	sleep_mode();
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef ANGLE_REF_H
+#define ANGLE_REF_H
+
+#include <math.h>
+#include <stdint.h>
+
+// Dive angle in hundredths of a degree, as UBX_SpeakValue computed it
+// before Angle.c. On the AVR, double is a 32-bit float.
+
+static int32_t Ref_DiveAngle(
+	int32_t velD,
+	int32_t gSpeed)
+{
+	return 100 * atan2(velD, gSpeed) / M_PI * 180;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Compares Angle_Atan2 with atan2 from libm in double precision.
+//
+// Usage: angle_test        Every pair of arguments up to 1024 in magnitude,
+//                          plus edge cases and pseudo-random pairs
+//        angle_test all    Every velD and gSpeed in the dive angle mode's
+//                          range, -32768 to 32767 and 0 to 32767 cm/s
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Angle.h"
+
+#define MAX_ERROR 1.0 // Allowed difference from the exact angle (0.01 deg)
+
+static unsigned long long checks = 0;
+static unsigned long failures = 0;
+static double max_error = 0;
+static int32_t worst_y, worst_x;
+
+static void check(
+	int32_t y,
+	int32_t x)
+{
+	double exact = atan2(y, x) * 18000 / M_PI;
+	double err = fabs(Angle_Atan2(y, x) - exact);
+
+	++checks;
+
+	if (err > max_error)
+	{
+		max_error = err;
+		worst_y = y;
+		worst_x = x;
+	}
+
+	if (err > MAX_ERROR && failures++ < 10)
+	{
+		printf("Mismatch: atan2(%ld, %ld) = %d, exact %.3f\n",
+			(long) y, (long) x, Angle_Atan2(y, x), exact);
+	}
+}
+
+int main(
+	int  argc,
+	char *argv[])
+{
+	static const int32_t edges[] =
+	{
+		0, 1, -1, 65535, 65536, -65536, 65537,
+		INT32_MAX, INT32_MIN, INT32_MIN + 1, INT32_MAX - 1
+	};
+
+	int32_t x, y;
+	uint32_t r = 1;
+	size_t j, k;
+	long i;
+
+	if (argc == 2 && !strcmp(argv[1], "all"))
+	{
+		for (x = 0; x <= 32767; ++x)
+		{
+			for (y = -32768; y <= 32767; ++y)
+			{
+				check(y, x);
+			}
+		}
+	}
+	else
+	{
+		// Every pair around the origin, in all four quadrants
+		for (x = -1024; x <= 1024; ++x)
+		{
+			for (y = -1024; y <= 1024; ++y)
+			{
+				check(y, x);
+			}
+		}
+
+		// The axes, diagonals and extremes
+		for (j = 0; j < sizeof(edges) / sizeof(edges[0]); ++j)
+		{
+			for (k = 0; k < sizeof(edges) / sizeof(edges[0]); ++k)
+			{
+				check(edges[j], edges[k]);
+			}
+		}
+
+		// Pseudo-random pairs over the whole range
+		for (i = 0; i < 10000000; ++i)
+		{
+			r ^= r << 13;
+			r ^= r >> 17;
+			r ^= r << 5;
+			x = r;
+			r ^= r << 13;
+			r ^= r >> 17;
+			r ^= r << 5;
+			y = r;
+
+			// Also at every magnitude, not just near 2^31
+			check(y, x);
+			check(y >> (i & 31), x >> ((i >> 5) & 31));
+		}
+	}
+
+	printf("%llu checks, %lu failures, largest error %.3f hundredths at atan2(%ld, %ld)\n",
+		checks, failures, max_error, (long) worst_y, (long) worst_x);
+
+	return failures ? 1 : 0;
+}
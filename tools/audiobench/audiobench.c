@@ -0,0 +1,224 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Measures the share of CPU time taken by the audio engine in Tone.c while
+// it plays a beep or a WAV. Built for an ATmega644, which has the same AVR
+// core as the AT90USB646, and run under simavr; results are printed on the
+// simavr console.
+//
+// The main loop counts how often it can call Tone_Task in one second, and
+// compares that with the count when nothing is playing. The difference is
+// the time spent in TIMER1_OVF_vect and in refilling the sample buffer.
+// File reads are stubbed, so SD card time is not included. Since only the
+// public Tone API is used, the benchmark also builds against older
+// revisions of Tone.c for comparison.
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "avr_mcu_section.h"
+
+#include "FatFS/ff.h"
+#include "Main.h"
+#include "Tone.h"
+
+AVR_MCU(F_CPU, "atmega644");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define BENCH_TICKS (F_CPU / 1024)  // Timer 2 ticks in one second
+
+uint8_t Main_buffer[MAIN_BUFFER_SIZE];
+
+// Tone.c uses GPIOR0 for its PWM queue while playing, so the console is
+// only written between measurements
+static void Bench_WriteString(
+	const char *str)
+{
+	char ch;
+
+	while ((ch = pgm_read_byte(str++)) != 0)
+	{
+		GPIOR0 = ch;
+	}
+}
+
+static void Bench_WriteNumber(
+	uint32_t val)
+{
+	char buf[11];
+	char *ptr = buf + sizeof(buf);
+
+	*--ptr = 0;
+	do
+	{
+		*--ptr = '0' + val % 10;
+		val /= 10;
+	}
+	while (val);
+
+	while (*ptr)
+	{
+		GPIOR0 = *ptr++;
+	}
+}
+
+// Stand-ins for the FatFS calls made by Tone_Play. The WAV header reports
+// more samples than one measurement consumes.
+
+static DWORD Bench_pos;
+
+int disk_is_ready(void)
+{
+	return 1;
+}
+
+FRESULT f_chdir(
+	const TCHAR *path)
+{
+	return FR_OK;
+}
+
+FRESULT f_open(
+	FIL         *fp,
+	const TCHAR *path,
+	BYTE        mode)
+{
+	Bench_pos = 0;
+	return FR_OK;
+}
+
+FRESULT f_lseek(
+	FIL   *fp,
+	DWORD ofs)
+{
+	Bench_pos = ofs;
+	return FR_OK;
+}
+
+FRESULT f_read(
+	FIL  *fp,
+	void *buff,
+	UINT btr,
+	UINT *br)
+{
+	uint8_t *ptr = buff;
+	UINT     i;
+
+	if (Bench_pos == 40)
+	{
+		*(uint32_t *) buff = 0x100000;
+	}
+	else
+	{
+		for (i = 0; i < btr; ++i)
+		{
+			ptr[i] = Bench_pos + i;
+		}
+	}
+
+	Bench_pos += btr;
+	*br = btr;
+
+	return FR_OK;
+}
+
+FRESULT f_close(
+	FIL *fp)
+{
+	return FR_OK;
+}
+
+static uint32_t Bench_Spin(void)
+{
+	uint32_t count = 0;
+	uint16_t elapsed = 0;
+	uint8_t  last = TCNT2, now;
+
+	while (elapsed < BENCH_TICKS)
+	{
+		Tone_Task();
+
+		now = TCNT2;
+		elapsed += (uint8_t) (now - last);
+		last = now;
+
+		++count;
+	}
+
+	return count;
+}
+
+static void Bench_Report(
+	const char *name,
+	uint32_t   idle,
+	uint32_t   count)
+{
+	uint32_t tenths = 1000 - count * 1000 / idle;
+
+	Tone_Stop();
+
+	Bench_WriteString(name);
+	Bench_WriteNumber(tenths / 10);
+	GPIOR0 = '.';
+	Bench_WriteNumber(tenths % 10);
+	Bench_WriteString(PSTR("% CPU\n"));
+}
+
+int main(void)
+{
+	uint32_t idle;
+
+	// Timer 2 free-running at F_CPU / 1024
+	TCCR2A = 0;
+	TCCR2B = (1 << CS22) | (1 << CS21) | (1 << CS20);
+
+	Tone_Init();
+	sei();
+
+	idle = Bench_Spin();
+
+	Tone_volume = 2;
+	Tone_Beep(TONE_MAX_PITCH / 2, 0, UINT16_MAX);
+	Bench_Report(PSTR("beep:           "), idle, Bench_Spin());
+
+	Tone_Beep(0, TONE_CHIRP_MAX, UINT16_MAX);
+	Bench_Report(PSTR("chirp:          "), idle, Bench_Spin());
+
+	Tone_sp_volume = 0;
+	Tone_Play("bench.wav");
+	Bench_Report(PSTR("wav:            "), idle, Bench_Spin());
+
+	Tone_sp_volume = 2;
+	Tone_Play("bench.wav");
+	Bench_Report(PSTR("wav, scaled:    "), idle, Bench_Spin());
+
+	// Stop the simulation
+	cli();
+	sleep_mode();
+
+	return 0;
+}
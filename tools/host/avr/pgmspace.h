@@ -0,0 +1,13 @@
+// Host stand-in for avr/pgmspace.h, so firmware sources build with a host
+// compiler in the tool tests
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define pgm_read_word(addr) (*(const uint16_t *) (addr))
+
+#endif
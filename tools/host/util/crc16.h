@@ -0,0 +1,23 @@
+// Host stand-in for util/crc16.h, so mmc.c builds with a host compiler
+
+#ifndef HOST_CRC16_H
+#define HOST_CRC16_H
+
+#include <stdint.h>
+
+static inline uint16_t _crc_xmodem_update(
+	uint16_t crc,
+	uint8_t  data)
+{
+	uint8_t i;
+
+	crc ^= (uint16_t) data << 8;
+	for (i = 0; i < 8; ++i)
+	{
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+
+	return crc;
+}
+
+#endif
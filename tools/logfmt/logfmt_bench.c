@@ -0,0 +1,110 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Times Log_WriteInt32ToBuf against the ldiv-based reference on the host,
+// using the field widths of a CSV log row. Host timings only give a rough
+// ratio; on the AVR, the reference spends most of its time in the software
+// 32-bit division.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "Log.h"
+#include "logfmt_ref.h"
+
+#define BUF_LEN 32
+#define ROWS    2000000
+
+typedef char *(*formatter_t)(char *, int32_t, int8_t, int8_t, char);
+
+typedef struct
+{
+	int32_t val;
+	int8_t  dec;
+	int8_t  dot;
+}
+field_t;
+
+// A typical row, in the order written by UBX_WriteCSVRecord
+static const field_t fields[] =
+{
+	{ 2400,       0, 0 }, // stack
+	{ 9,          0, 1 }, // numSV
+	{ 3,          0, 1 }, // gpsFix
+	{ 123456,     5, 1 }, // cAcc
+	{ 27512345,   5, 1 }, // heading
+	{ 54,         2, 1 }, // sAcc
+	{ 4321,       3, 1 }, // vAcc
+	{ 2345,       3, 1 }, // hAcc
+	{ 5012,       2, 1 }, // velD
+	{ -1234,      2, 1 }, // velE
+	{ 2345,       2, 1 }, // velN
+	{ 3012345,    3, 1 }, // hMSL
+	{ -750123456, 7, 1 }, // lon
+	{ 450123456,  7, 1 }, // lat
+	{ 50,         2, 0 }, // hundredths
+	{ 9,          2, 0 }, // sec
+	{ 8,          2, 0 }, // min
+	{ 7,          2, 0 }, // hour
+	{ 6,          2, 0 }, // day
+	{ 5,          2, 0 }, // month
+	{ 2020,       4, 0 }, // year
+};
+
+#define NUM_FIELDS (sizeof(fields) / sizeof(field_t))
+
+static volatile char sink;
+
+static double run(
+	formatter_t format)
+{
+	char buf[BUF_LEN];
+	clock_t start = clock();
+	long row;
+	size_t i;
+
+	for (row = 0; row < ROWS; ++row)
+	{
+		for (i = 0; i < NUM_FIELDS; ++i)
+		{
+			// Vary the value so the work can't be hoisted out of the loop
+			sink = *format(buf + BUF_LEN, fields[i].val + (row & 7),
+				fields[i].dec, fields[i].dot, ',');
+		}
+	}
+
+	return (double) (clock() - start) / CLOCKS_PER_SEC * 1e9 / ROWS;
+}
+
+int main(void)
+{
+	double ref = run(Ref_WriteInt32ToBuf);
+	double now = run(Log_WriteInt32ToBuf);
+
+	printf("ldiv:          %8.1f ns/row\n", ref);
+	printf("shift and add: %8.1f ns/row\n", now);
+	printf("speedup:       %8.2fx\n", ref / now);
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef LOGFMT_REF_H
+#define LOGFMT_REF_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Log_WriteInt32ToBuf as it was before the division-free formatter, kept
+// as the reference for equivalence tests and benchmarks. Its output for
+// INT32_MIN depends on the sign of ldiv remainders, so that value is not
+// compared.
+
+static char *Ref_WriteInt32ToBuf(
+	char    *ptr, 
+	int32_t val, 
+	int8_t  dec, 
+	int8_t  dot, 
+	char    delimiter)
+{
+    int32_t value = val > 0 ? val : -val;
+
+    *--ptr = delimiter;
+    while (value > 0 || dec > 0)
+    {
+        ldiv_t res = ldiv(value, 10);
+        *--ptr = res.rem + '0';
+        value = res.quot;
+        if (--dec == 0 && dot)
+        {
+            *--ptr = '.';
+        }
+    }
+    if (*ptr == '.' || *ptr == delimiter)
+    {
+        *--ptr = '0';
+    }
+    if (val < 0)
+    {
+        *--ptr = '-';
+    }
+	
+	return ptr;
+}
+
+#endif
@@ -0,0 +1,153 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Compares Log_WriteInt32ToBuf with the ldiv-based reference.
+//
+// Usage: logfmt_test            Quick test of all dec/dot/delimiter cases
+//        logfmt_test dec dot    Every int32 value for one dec/dot pair
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Log.h"
+#include "logfmt_ref.h"
+
+#define BUF_LEN 32
+
+static const char delimiters[] = { ',', '\r', '.', 'Z', '0', 0 };
+
+static unsigned long failures = 0;
+
+static void check(
+	int32_t val,
+	int8_t  dec,
+	int8_t  dot,
+	char    delimiter)
+{
+	char ref_buf[BUF_LEN], new_buf[BUF_LEN];
+	char *ref_ptr, *new_ptr;
+	size_t ref_len, new_len;
+
+	if (val == INT32_MIN) return;
+
+	ref_ptr = Ref_WriteInt32ToBuf(ref_buf + BUF_LEN, val, dec, dot, delimiter);
+	new_ptr = Log_WriteInt32ToBuf(new_buf + BUF_LEN, val, dec, dot, delimiter);
+
+	ref_len = ref_buf + BUF_LEN - ref_ptr;
+	new_len = new_buf + BUF_LEN - new_ptr;
+
+	if (ref_len != new_len || memcmp(ref_ptr, new_ptr, ref_len))
+	{
+		if (failures++ < 10)
+		{
+			printf("Mismatch: val=%ld dec=%d dot=%d delimiter=0x%02x: \"%.*s\" != \"%.*s\"\n",
+				(long) val, dec, dot, (unsigned char) delimiter,
+				(int) ref_len, ref_ptr, (int) new_len, new_ptr);
+		}
+	}
+}
+
+static void check_all_cases(
+	int32_t val)
+{
+	int8_t dec, dot;
+	size_t i;
+
+	for (dec = -1; dec <= 11; ++dec)
+	{
+		for (dot = 0; dot <= 1; ++dot)
+		{
+			for (i = 0; i < sizeof(delimiters); ++i)
+			{
+				check(val, dec, dot, delimiters[i]);
+			}
+		}
+	}
+}
+
+int main(
+	int  argc,
+	char *argv[])
+{
+	int64_t v;
+	uint32_t x = 1;
+	int32_t p;
+	int i;
+
+	if (argc == 3)
+	{
+		int8_t dec = atoi(argv[1]);
+		int8_t dot = atoi(argv[2]);
+
+		for (v = INT32_MIN; v <= INT32_MAX; ++v)
+		{
+			check(v, dec, dot, ',');
+		}
+	}
+	else
+	{
+		// Every value around zero, where dec and dot matter most
+		for (v = -(1 << 17); v <= (1 << 17); ++v)
+		{
+			check_all_cases(v);
+		}
+
+		// Each side of every power of 10 and of the 16-bit boundary
+		for (p = 10; ; p *= 10)
+		{
+			for (v = p - 3; v <= p + 3; ++v)
+			{
+				check_all_cases(v);
+				check_all_cases(-v);
+			}
+			if (p > INT32_MAX / 10) break;
+		}
+		for (v = UINT16_MAX - 3; v <= UINT16_MAX + 3; ++v)
+		{
+			check_all_cases(v);
+			check_all_cases(-v);
+		}
+		check_all_cases(INT32_MAX);
+		check_all_cases(INT32_MIN + 1);
+
+		// Pseudo-random values over the whole range
+		for (i = 0; i < 1000000; ++i)
+		{
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			check_all_cases((int32_t) x);
+		}
+	}
+
+	if (failures)
+	{
+		printf("%lu mismatches\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,79 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef PREDICT_REF_H
+#define PREDICT_REF_H
+
+#include <stdint.h>
+
+// Least squares line through n samples, newest first, evaluated lead ms
+// past the newest one. age[i] is the age of sample i (ms).
+
+static double Ref_FitValue(
+	const double *x,
+	const double *age,
+	int           n,
+	double        lead)
+{
+	double mx = 0, mt = 0, sxy = 0, sxx = 0;
+	int i;
+
+	for (i = 0; i < n; ++i)
+	{
+		mx += x[i] / n;
+		mt -= age[i] / n;
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		sxy += (-age[i] - mt) * (x[i] - mx);
+		sxx += (-age[i] - mt) * (-age[i] - mt);
+	}
+
+	return sxx > 0 ? mx + sxy / sxx * (lead - mt) : x[0];
+}
+
+// The line Predict_Value uses, through the mean of the samples with the
+// slope between the oldest and newest
+
+static double Ref_PredictValue(
+	const double *x,
+	const double *age,
+	int           n,
+	double        lead)
+{
+	double mx = 0, mt = 0;
+	int i;
+
+	if (n < 2) return x[0];
+
+	for (i = 0; i < n; ++i)
+	{
+		mx += x[i] / n;
+		mt -= age[i] / n;
+	}
+
+	return mx + (x[0] - x[n - 1]) / age[n - 1] * (lead - mt);
+}
+
+#endif
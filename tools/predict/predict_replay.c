@@ -0,0 +1,408 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Replays tracks through Predict_Value and compares the tone values the
+// firmware would derive, with and without prediction, to the values
+// measured lead ms later.
+//
+// Usage: predict_replay [-l lead] [-t thresh] [track.csv ...]
+//
+// lead is the latency to compensate (ms, default 300) and thresh the
+// smallest vertical speed for which a tone is played (cm/s, default 1000,
+// as V_Thresh). Without files, a synthetic swoop with measurement noise
+// is replayed.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Predict.h"
+
+#define LINE_LEN   512
+#define MAX_FIELDS 32
+#define MAX_GAP    1000 // Longest gap interpolated across (ms)
+
+typedef struct
+{
+	double  time;   // Time of day (ms)
+	int32_t velD;   // Down velocity (cm/s)
+	int32_t gSpeed; // Ground speed  (cm/s)
+	int32_t speed;  // 3D speed      (cm/s)
+	int     fix;    // Fix type
+}
+sample_t;
+
+typedef struct
+{
+	const char *name;
+	const char *units;
+	double      latest;    // Sum of squared errors without prediction
+	double      predicted; // Sum of squared errors with prediction
+	double      worst[2];  // Largest error without and with prediction
+	unsigned long count;
+}
+stats_t;
+
+static stats_t modes[] =
+{
+	{"Horizontal speed", "m/s"},
+	{"Vertical speed",   "m/s"},
+	{"Glide ratio",      ""},
+	{"Total speed",      "m/s"},
+	{"Dive angle",       "deg"}
+};
+
+#define NUM_MODES (sizeof(modes) / sizeof(stats_t))
+
+static uint16_t lead      = 300;
+static int32_t  threshold = 1000;
+
+static sample_t *samples;
+static size_t num_samples, max_samples;
+
+static void add_sample(
+	double time,
+	double velN,
+	double velE,
+	double velD,
+	int    fix)
+{
+	sample_t *s;
+	double gSpeed = sqrt(velN * velN + velE * velE);
+
+	if (num_samples == max_samples)
+	{
+		max_samples = max_samples ? 2 * max_samples : 1024;
+		samples = realloc(samples, max_samples * sizeof(sample_t));
+		if (!samples)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+
+	s = samples + num_samples++;
+	s->time   = time;
+	s->velD   = lround(velD * 100);
+	s->gSpeed = lround(gSpeed * 100);
+	s->speed  = lround(sqrt(gSpeed * gSpeed + velD * velD) * 100);
+	s->fix    = fix;
+}
+
+static int split(
+	char *line,
+	char **fields)
+{
+	int n = 0;
+
+	line[strcspn(line, "\r\n")] = 0;
+	fields[n++] = line;
+
+	while (n < MAX_FIELDS && (line = strchr(line, ',')))
+	{
+		*line++ = 0;
+		fields[n++] = line;
+	}
+
+	return n;
+}
+
+static int find_field(
+	char **fields,
+	int n,
+	const char *name)
+{
+	int i;
+
+	for (i = 0; i < n; ++i)
+	{
+		if (!strcmp(fields[i], name)) return i;
+	}
+
+	fprintf(stderr, "Missing column %s\n", name);
+	exit(1);
+}
+
+static void read_track(
+	const char *path)
+{
+	char line[LINE_LEN], *fields[MAX_FIELDS];
+	int n, time_col, velN_col, velE_col, velD_col, fix_col;
+	double day = 0, prev = 0;
+	FILE *f = fopen(path, "r");
+
+	if (!f || !fgets(line, sizeof(line), f))
+	{
+		fprintf(stderr, "Can't read %s\n", path);
+		exit(1);
+	}
+
+	n = split(line, fields);
+	time_col = find_field(fields, n, "time");
+	velN_col = find_field(fields, n, "velN");
+	velE_col = find_field(fields, n, "velE");
+	velD_col = find_field(fields, n, "velD");
+	fix_col  = find_field(fields, n, "gpsFix");
+
+	while (fgets(line, sizeof(line), f))
+	{
+		int hour, min;
+		double sec, time;
+
+		if (split(line, fields) < n) continue;
+		if (sscanf(fields[time_col], "%*d-%*d-%*dT%d:%d:%lf", &hour, &min, &sec) != 3) continue;
+
+		time = ((hour * 60 + min) * 60 + sec) * 1000 + day;
+		if (time < prev)
+		{
+			day += 86400000;
+			time += 86400000;
+		}
+		prev = time;
+
+		add_sample(time, atof(fields[velN_col]), atof(fields[velE_col]),
+			atof(fields[velD_col]), atoi(fields[fix_col]));
+	}
+
+	fclose(f);
+}
+
+static double gaussian(void)
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Smooth pulse over [start, end) s, peaking at 1
+
+static double pulse(
+	double t,
+	double start,
+	double end)
+{
+	double s;
+
+	if (t < start || t >= end) return 0;
+
+	s = sin(M_PI * (t - start) / (end - start));
+	return s * s;
+}
+
+// A minute under canopy at 5 Hz: three diving turns, each followed by a
+// swoop that bleeds off vertical speed into horizontal speed. Velocities
+// have 0.15 m/s of noise, about what the receiver reports in sAcc.
+
+static void synthetic_track(void)
+{
+	double t;
+
+	srand(1);
+
+	for (t = 0; t < 60000; t += 200)
+	{
+		double phase = fmod(t, 20000) / 1000;
+		double velD   = 12 + 14 * pulse(phase, 0, 7) - 6 * pulse(phase, 5, 12);
+		double gSpeed = 12 +  6 * pulse(phase, 0, 6) + 10 * pulse(phase, 4, 12);
+
+		add_sample(t, gSpeed + 0.15 * gaussian(), 0.15 * gaussian(),
+			velD + 0.15 * gaussian(), 3);
+	}
+}
+
+// Tone values as in UBX_GetValues, without the airspeed correction since
+// it scales both sides of each comparison alike
+
+static int values(
+	int32_t velD,
+	int32_t gSpeed,
+	int32_t speed,
+	double *val)
+{
+	if (velD == 0) return 0;
+
+	val[0] = gSpeed / 100.;
+	val[1] = velD / 100.;
+	val[2] = (double) gSpeed / velD;
+	val[3] = speed / 100.;
+	val[4] = atan2(velD, gSpeed) / M_PI * 180;
+
+	return 1;
+}
+
+// Collects the samples UBX_Predict would use for sample i, newest first
+
+static uint8_t history(
+	size_t i,
+	uint16_t *age)
+{
+	uint8_t n;
+
+	age[0] = 0;
+
+	for (n = 1; n < PREDICT_LEN && n <= i; ++n)
+	{
+		const sample_t *prev = samples + i - n;
+		double dt = samples[i].time - prev->time;
+
+		if (prev->fix != 3 || dt <= age[n - 1] || dt > PREDICT_MAX_AGE) break;
+
+		age[n] = dt;
+	}
+
+	return n;
+}
+
+static void replay(void)
+{
+	size_t i, j = 0;
+
+	for (i = 0; i < num_samples; ++i)
+	{
+		const sample_t *s = samples + i;
+		double target = s->time + lead, f;
+		double actual[NUM_MODES], latest[NUM_MODES], predicted[NUM_MODES];
+		int32_t x[PREDICT_LEN], p[3];
+		uint16_t age[PREDICT_LEN];
+		uint8_t n, k, m;
+
+		if (s->fix != 3 || labs(s->velD) < threshold) continue;
+
+		// Measurement at the time the tone is heard
+
+		while (j + 1 < num_samples && samples[j + 1].time <= target) ++j;
+		if (j + 1 >= num_samples || samples[j].time > target) continue;
+		if (samples[j + 1].time - samples[j].time > MAX_GAP) continue;
+		if (samples[j].fix != 3 || samples[j + 1].fix != 3) continue;
+
+		f = (target - samples[j].time) / (samples[j + 1].time - samples[j].time);
+
+		#define LERP(field) lround(samples[j].field + f * (samples[j + 1].field - samples[j].field))
+
+		if (labs(LERP(velD)) < threshold) continue;
+		if (!values(LERP(velD), LERP(gSpeed), LERP(speed), actual)) continue;
+
+		#undef LERP
+
+		// Prediction from the samples the firmware has at this point
+
+		n = history(i, age);
+
+		#define PREDICT(field, k) \
+			for (m = 0; m < n; ++m) x[m] = samples[i - m].field; \
+			p[k] = Predict_Value(x, age, n, lead);
+
+		PREDICT(velD, 0);
+		PREDICT(gSpeed, 1);
+		PREDICT(speed, 2);
+
+		#undef PREDICT
+
+		if (p[1] < 0) p[1] = 0;
+		if (p[2] < 0) p[2] = 0;
+
+		if (!values(s->velD, s->gSpeed, s->speed, latest)) continue;
+		if (!values(p[0], p[1], p[2], predicted)) continue;
+
+		for (k = 0; k < NUM_MODES; ++k)
+		{
+			double e0 = fabs(latest[k] - actual[k]);
+			double e1 = fabs(predicted[k] - actual[k]);
+
+			modes[k].latest    += e0 * e0;
+			modes[k].predicted += e1 * e1;
+			if (e0 > modes[k].worst[0]) modes[k].worst[0] = e0;
+			if (e1 > modes[k].worst[1]) modes[k].worst[1] = e1;
+			++modes[k].count;
+		}
+	}
+}
+
+int main(
+	int  argc,
+	char *argv[])
+{
+	int i;
+	size_t k;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-l") && i + 1 < argc)
+		{
+			lead = atoi(argv[++i]);
+			if (lead > PREDICT_MAX_LEAD)
+			{
+				fprintf(stderr, "Lead is at most %d ms\n", PREDICT_MAX_LEAD);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+		{
+			threshold = atoi(argv[++i]);
+		}
+		else
+		{
+			size_t first = num_samples;
+
+			read_track(argv[i]);
+
+			// Keep tracks apart so that no fit spans two of them
+
+			if (first > 0 && num_samples > first)
+			{
+				double shift = samples[first - 1].time + 2 * PREDICT_MAX_AGE - samples[first].time;
+				size_t j;
+
+				for (j = first; j < num_samples; ++j) samples[j].time += shift;
+			}
+		}
+	}
+
+	if (num_samples == 0)
+	{
+		printf("Synthetic swoop\n");
+		synthetic_track();
+	}
+
+	replay();
+
+	printf("Lead %u ms, %lu tone updates\n\n", lead, modes[0].count);
+	printf("%-18s %12s %12s %9s %12s %12s\n", "", "RMS latest", "predicted", "change", "max latest", "predicted");
+
+	for (k = 0; k < NUM_MODES; ++k)
+	{
+		double r0 = modes[k].count ? sqrt(modes[k].latest / modes[k].count) : 0;
+		double r1 = modes[k].count ? sqrt(modes[k].predicted / modes[k].count) : 0;
+
+		printf("%-18s %8.3f %-3s %8.3f %-3s %8.1f%% %8.3f %-3s %8.3f %-3s\n",
+			modes[k].name,
+			r0, modes[k].units, r1, modes[k].units,
+			r0 > 0 ? 100 * (r1 - r0) / r0 : 0,
+			modes[k].worst[0], modes[k].units, modes[k].worst[1], modes[k].units);
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Compares Predict_Value with the floating point line it approximates,
+// and with the least squares fit for evenly spaced samples.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Predict.h"
+#include "predict_ref.h"
+
+#define MAX_ERROR 1.5 // Allowed difference from the reference (cm/s)
+
+static unsigned long checks = 0, failures = 0;
+static double max_error = 0;
+
+static uint32_t rand_state = 1;
+
+static uint32_t rand32(void)
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+static int32_t rand_range(
+	int32_t lo,
+	int32_t hi)
+{
+	return lo + (int32_t) (rand32() % (uint32_t) (hi - lo + 1));
+}
+
+static void check(
+	const int32_t  *x,
+	const uint16_t *age,
+	uint8_t         n,
+	uint16_t        lead,
+	int             even)
+{
+	double xd[PREDICT_LEN], ad[PREDICT_LEN], ref, err;
+	int32_t val;
+	int i;
+
+	for (i = 0; i < n; ++i)
+	{
+		xd[i] = x[i];
+		ad[i] = age[i];
+	}
+
+	val = Predict_Value(x, age, n, lead);
+	ref = even ? Ref_FitValue(xd, ad, n, lead) : Ref_PredictValue(xd, ad, n, lead);
+	err = fabs(val - ref);
+
+	++checks;
+	if (err > max_error) max_error = err;
+
+	if (err > MAX_ERROR && failures++ < 10)
+	{
+		printf("Mismatch: n=%d lead=%u x=%ld,%ld,%ld age=%u,%u,%u: %ld != %.2f\n",
+			n, lead,
+			(long) x[0], (long) (n > 1 ? x[1] : 0), (long) (n > 2 ? x[2] : 0),
+			age[0], n > 1 ? age[1] : 0, n > 2 ? age[2] : 0,
+			(long) val, ref);
+	}
+}
+
+static void random_case(
+	int even)
+{
+	int32_t  x[PREDICT_LEN];
+	uint16_t age[PREDICT_LEN];
+	uint8_t  n = rand_range(1, PREDICT_LEN);
+	uint16_t lead = rand_range(0, PREDICT_MAX_LEAD);
+	uint16_t step = rand_range(1, PREDICT_MAX_AGE / (PREDICT_LEN - 1));
+	int32_t  base = rand_range(-100000, 100000);
+	int i;
+
+	x[0] = base;
+	age[0] = 0;
+
+	for (i = 1; i < n; ++i)
+	{
+		// Keep the oldest sample within the clamp on the change across
+		// a fit, which the floating point lines do not have
+
+		x[i] = base + rand_range(-100000, 100000);
+		age[i] = even ? i * step : rand_range(age[i - 1] + 1, age[i - 1] + step);
+	}
+
+	check(x, age, n, lead, even);
+}
+
+int main(void)
+{
+	int32_t  x[PREDICT_LEN];
+	uint16_t age[PREDICT_LEN];
+	int i;
+
+	// Pseudo-random samples, evenly and unevenly spaced
+	for (i = 0; i < 1000000; ++i)
+	{
+		random_case(1);
+		random_case(0);
+	}
+
+	// The largest products the firmware can form
+	x[0] =  PREDICT_MAX_DIFF / 2;
+	x[1] =  0;
+	x[2] = -PREDICT_MAX_DIFF / 2;
+	age[0] = 0;
+	age[1] = PREDICT_MAX_AGE / 2;
+	age[2] = PREDICT_MAX_AGE;
+	check(x, age, 3, PREDICT_MAX_LEAD, 1);
+	x[0] = -x[0];
+	x[2] = -x[2];
+	check(x, age, 3, PREDICT_MAX_LEAD, 1);
+
+	// A straight line is followed exactly
+	for (i = 0; i < PREDICT_LEN; ++i)
+	{
+		age[i] = 200 * i;
+		x[i] = 5000 - 3 * age[i];
+	}
+	if (Predict_Value(x, age, PREDICT_LEN, 300) != 5900)
+	{
+		printf("Line: %ld != 5900\n", (long) Predict_Value(x, age, PREDICT_LEN, 300));
+		++failures;
+	}
+	++checks;
+
+	printf("%lu checks, %lu failures, largest error %.3f\n", checks, failures, max_error);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+// Host stand-in for avr/io.h, so mmc.c builds with a host C++ compiler. SPDR
+// and SPSR are objects that hand each transfer to the card model in
+// sdbench_test.cpp, and count the accesses the SPI port does not allow.
+
+#ifndef SDBENCH_IO_H
+#define SDBENCH_IO_H
+
+#include <stdint.h>
+
+#define F_CPU 8000000UL
+
+#define SPIF 7
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit) do { } while (bit_is_clear(sfr, bit))
+
+struct Spi_data_t
+{
+	Spi_data_t &operator=(uint8_t val); // Starts a transfer
+	operator uint8_t();                 // Reads the last byte received
+};
+
+struct Spi_status_t
+{
+	Spi_status_t &operator=(uint8_t val);
+	operator uint8_t();                 // Finishes the transfer in progress
+};
+
+extern Spi_data_t   SPDR;
+extern Spi_status_t SPSR;
+extern uint8_t      SPCR, PORTB;
+
+#endif
@@ -0,0 +1,159 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Counts AVR cycles spent by the pipelined block loops in mmc.c and by the
+// loops they replaced, for a 512-byte sector at fosc/2. Built for an
+// ATmega644, which has the same AVR core and SPI port as the AT90USB646, and
+// run under simavr. Results are printed on the simavr console.
+//
+// No card is attached, so the received data is meaningless and only the
+// timing counts. The first row times one bare transfer, so that the SPI
+// timing simavr models can be checked against the 16 cycles the port takes
+// at fosc/2. It includes a few cycles of timer overhead.
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <stdint.h>
+
+#include "avr_mcu_section.h"
+
+#include "FatFS/mmc.c"
+#include "sdbench_ref.h"
+
+AVR_MCU(F_CPU, "atmega644");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define ROUNDS 16
+
+static uint8_t Bench_buffer[512];
+
+static void Bench_WriteString(
+	const char *str)
+{
+	char ch;
+
+	while ((ch = pgm_read_byte(str++)) != 0)
+	{
+		GPIOR0 = ch;
+	}
+}
+
+static void Bench_WriteNumber(
+	uint32_t val)
+{
+	char buf[11];
+	char *ptr = buf + sizeof(buf);
+
+	*--ptr = 0;
+	do
+	{
+		*--ptr = '0' + val % 10;
+		val /= 10;
+	}
+	while (val);
+
+	while (*ptr)
+	{
+		GPIOR0 = *ptr++;
+	}
+}
+
+// Reports cycles per sector, and cycles per byte to one decimal
+static void Bench_Report(
+	const char *name,
+	uint32_t   cycles)
+{
+	uint32_t tenths = cycles * 10 / ((uint32_t) ROUNDS * sizeof(Bench_buffer));
+
+	Bench_WriteString(name);
+	Bench_WriteNumber(cycles / ROUNDS);
+	Bench_WriteString(PSTR(" cycles/sector, "));
+	Bench_WriteNumber(tenths / 10);
+	GPIOR0 = '.';
+	Bench_WriteNumber(tenths % 10);
+	Bench_WriteString(PSTR(" cycles/byte\n"));
+}
+
+static inline void Bench_Start(void)
+{
+	TCCR1A = 0;
+	TCCR1B = (1 << CS10);
+	TCNT1  = 0;
+}
+
+static inline uint16_t Bench_Stop(void)
+{
+	return TCNT1;
+}
+
+int main(void)
+{
+	uint32_t ref_rcvr = 0, new_rcvr = 0, ref_xmit = 0, new_xmit = 0;
+	uint16_t byte;
+	uint8_t  round;
+
+	// SS, MOSI and SCK are outputs, so that the port stays in master mode
+	DDRB = _BV(PB0) | _BV(PB4) | _BV(PB5) | _BV(PB7);
+	FCLK_SET(0);
+
+	Bench_Start();
+	SPDR = 0xFF;
+	loop_until_bit_is_set(SPSR, SPIF);
+	byte = Bench_Stop();
+	(void) SPDR;
+
+	for (round = 0; round < ROUNDS; ++round)
+	{
+		Bench_Start();
+		Ref_RcvrBlock(Bench_buffer, sizeof(Bench_buffer));
+		ref_rcvr += Bench_Stop();
+
+		Bench_Start();
+		rcvr_spi_block(Bench_buffer, sizeof(Bench_buffer));
+		new_rcvr += Bench_Stop();
+
+		Bench_Start();
+		Ref_XmitBlock(Bench_buffer);
+		ref_xmit += Bench_Stop();
+
+		Bench_Start();
+		xmit_spi_block(Bench_buffer);
+		new_xmit += Bench_Stop();
+	}
+
+	Bench_WriteString(PSTR("One transfer: "));
+	Bench_WriteNumber(byte);
+	Bench_WriteString(PSTR(" cycles\n"));
+	Bench_Report(PSTR("receive, before:  "), ref_rcvr);
+	Bench_Report(PSTR("receive, after:   "), new_rcvr);
+	Bench_Report(PSTR("transmit, before: "), ref_xmit);
+	Bench_Report(PSTR("transmit, after:  "), new_xmit);
+
+	// Stop the simulation
+	cli();
+	sleep_mode();
+
+	return 0;
+}
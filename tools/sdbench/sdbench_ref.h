@@ -0,0 +1,67 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef SDBENCH_REF_H
+#define SDBENCH_REF_H
+
+#include <avr/io.h>
+
+// The rcvr_datablock and xmit_datablock loops as they were before they were
+// pipelined, kept as the reference for benchmarks. Each byte waits for SPIF
+// before the buffer is read or written. The receive loop clocks one byte
+// more than the block, as rcvr_spi_block does.
+
+#define Ref_rcvr_spi_m(dst) SPDR = 0xFF; loop_until_bit_is_set(SPSR, SPIF); *(dst) = SPDR
+#define Ref_xmit_spi(dat)   SPDR = (dat); loop_until_bit_is_set(SPSR, SPIF)
+
+static void Ref_RcvrBlock(
+	uint8_t  *buff,
+	uint16_t btr)
+{
+	do
+	{
+		Ref_rcvr_spi_m(buff++);
+		Ref_rcvr_spi_m(buff++);
+		Ref_rcvr_spi_m(buff++);
+		Ref_rcvr_spi_m(buff++);
+	}
+	while (btr -= 4);
+
+	SPDR = 0xFF;
+	loop_until_bit_is_set(SPSR, SPIF);
+}
+
+static void Ref_XmitBlock(
+	const uint8_t *buff)
+{
+	uint8_t wc = 0;
+
+	do
+	{
+		Ref_xmit_spi(*buff++);
+		Ref_xmit_spi(*buff++);
+	}
+	while (--wc);
+}
+
+#endif
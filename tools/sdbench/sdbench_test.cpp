@@ -0,0 +1,570 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Checks the pipelined block loops in mmc.c against a model of the SPI port
+// and a scripted card. Blocks of several sizes are received and a 512-byte
+// block is transmitted. Every byte must arrive intact, exactly the expected
+// bytes must be clocked, and SPDR must never be written while a transfer is
+// in progress or read before it has finished. mmc.c is built as C++ so that
+// SPDR and SPSR can be modelled as objects.
+//
+// disk_write is then run against an emulated card that decodes commands and
+// tokens. Writes to consecutive sectors must continue one multiple block
+// write, anything else must close it with a stop token first, and nothing
+// but tokens may reach the card while it is open.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FatFS/mmc.c"
+
+#define CARD_LEN 1024
+
+static uint8_t  Card_in[CARD_LEN];  // Bytes returned by the card
+static uint8_t  Card_out[CARD_LEN]; // Bytes sent to the card
+static uint16_t Card_in_len;
+static uint16_t Card_clocked;
+
+static uint8_t  Spi_rx;
+static bool     Spi_busy;           // A transfer is in progress
+static bool     Spi_flag;           // SPIF is set
+
+static unsigned long Spi_collisions; // SPDR written during a transfer
+static unsigned long Spi_early;      // SPDR read during a transfer
+static unsigned long Spi_stalls;     // SPIF polled with no transfer started
+
+Spi_data_t   SPDR;
+Spi_status_t SPSR;
+uint8_t      SPCR, PORTB;
+
+static bool     Card_emulated;      // Use the emulated card, not Card_in
+
+#define EMU_SECTORS 64
+#define EMU_QUEUE   600
+
+enum
+{
+	EMU_IDLE,   // Waiting for a command
+	EMU_CMD,    // Receiving a command
+	EMU_TOKEN,  // In a multiple block write, waiting for a token
+	EMU_DATA,   // Receiving a data block
+	EMU_CRC     // Receiving the CRC of a data block
+};
+
+static uint8_t  Emu_image[EMU_SECTORS][512];
+static uint8_t  Emu_state;
+static uint8_t  Emu_cmd[6];
+static uint16_t Emu_len;
+static uint32_t Emu_sector;
+static uint8_t  Emu_queue[EMU_QUEUE]; // Bytes the card sends next
+static uint16_t Emu_head, Emu_tail;
+static uint8_t  Emu_busy;             // Busy bytes after a block or stop
+static uint8_t  Emu_reject;           // Reject this many more blocks
+
+static unsigned long Emu_cmd24, Emu_cmd25, Emu_blocks, Emu_stops;
+static unsigned long Emu_errors;      // Bytes the card could not take
+
+static unsigned long failures = 0;
+
+static void Emu_Queue(
+	uint8_t val)
+{
+	Emu_queue[Emu_tail++] = val;
+}
+
+static void Emu_Command(void)
+{
+	uint32_t arg = ((uint32_t) Emu_cmd[1] << 24) | ((uint32_t) Emu_cmd[2] << 16) |
+	               ((uint32_t) Emu_cmd[3] << 8) | Emu_cmd[4];
+	uint16_t i;
+
+	Emu_head = Emu_tail = 0;
+	Emu_Queue(0xFF);
+	Emu_Queue(0x00);
+	Emu_state = EMU_IDLE;
+
+	switch (Emu_cmd[0] & 0x3F)
+	{
+	case CMD17:
+		Emu_Queue(0xFF);
+		Emu_Queue(0xFE);
+		for (i = 0; i < 512; ++i)
+		{
+			Emu_Queue(Emu_image[arg % EMU_SECTORS][i]);
+		}
+		Emu_Queue(0xFF);
+		Emu_Queue(0xFF);
+		break;
+	case CMD24:
+		++Emu_cmd24;
+		++Emu_errors;
+		break;
+	case CMD25:
+		++Emu_cmd25;
+		Emu_sector = arg;
+		Emu_state = EMU_TOKEN;
+		break;
+	}
+}
+
+static uint8_t Emu_Exchange(
+	uint8_t val)
+{
+	if (PORTB & 1)
+	{
+		// Not selected
+		return 0xFF;
+	}
+
+	if (Emu_head != Emu_tail)
+	{
+		if (val != 0xFF)
+		{
+			++Emu_errors;
+		}
+		return Emu_queue[Emu_head++];
+	}
+
+	if (Emu_busy)
+	{
+		--Emu_busy;
+		return 0x00;
+	}
+
+	switch (Emu_state)
+	{
+	case EMU_IDLE:
+		if ((val & 0xC0) == 0x40)
+		{
+			Emu_cmd[0] = val;
+			Emu_len = 1;
+			Emu_state = EMU_CMD;
+		}
+		else if (val != 0xFF)
+		{
+			++Emu_errors;
+		}
+		break;
+	case EMU_CMD:
+		Emu_cmd[Emu_len++] = val;
+		if (Emu_len == 6)
+		{
+			Emu_Command();
+		}
+		break;
+	case EMU_TOKEN:
+		if (val == 0xFC)
+		{
+			Emu_len = 0;
+			Emu_state = EMU_DATA;
+		}
+		else if (val == 0xFD)
+		{
+			++Emu_stops;
+			Emu_busy = 3;
+			Emu_state = EMU_IDLE;
+		}
+		else if (val != 0xFF)
+		{
+			++Emu_errors;
+		}
+		break;
+	case EMU_DATA:
+		Emu_image[Emu_sector % EMU_SECTORS][Emu_len++] = val;
+		if (Emu_len == 512)
+		{
+			Emu_len = 0;
+			Emu_state = EMU_CRC;
+		}
+		break;
+	case EMU_CRC:
+		if (++Emu_len == 2)
+		{
+			Emu_head = Emu_tail = 0;
+			if (Emu_reject)
+			{
+				--Emu_reject;
+				Emu_Queue(0xEB);
+			}
+			else
+			{
+				++Emu_blocks;
+				++Emu_sector;
+				Emu_Queue(0xE5);
+				Emu_busy = 4;
+			}
+			Emu_state = EMU_TOKEN;
+		}
+		break;
+	}
+
+	return 0xFF;
+}
+
+Spi_data_t &Spi_data_t::operator=(
+	uint8_t val)
+{
+	if (Spi_busy)
+	{
+		++Spi_collisions;
+	}
+
+	if (Card_emulated)
+	{
+		Spi_rx = Emu_Exchange(val);
+	}
+	else
+	{
+		if (Card_clocked < CARD_LEN)
+		{
+			Card_out[Card_clocked] = val;
+		}
+		Spi_rx = (Card_clocked < Card_in_len) ? Card_in[Card_clocked] : 0xFF;
+		++Card_clocked;
+	}
+
+	Spi_busy = true;
+	Spi_flag = false;
+	return *this;
+}
+
+Spi_data_t::operator uint8_t()
+{
+	if (Spi_busy)
+	{
+		++Spi_early;
+	}
+
+	Spi_flag = false;
+	return Spi_rx;
+}
+
+Spi_status_t &Spi_status_t::operator=(
+	uint8_t val)
+{
+	(void) val;
+	return *this;
+}
+
+Spi_status_t::operator uint8_t()
+{
+	if (Spi_busy)
+	{
+		Spi_busy = false;
+		Spi_flag = true;
+	}
+	else if (!Spi_flag)
+	{
+		// The port would wait here forever
+		++Spi_stalls;
+	}
+
+	return _BV(SPIF);
+}
+
+static void Card_Reset(void)
+{
+	Card_emulated = false;
+	Card_in_len   = 0;
+	Card_clocked  = 0;
+
+	Spi_busy = false;
+	Spi_flag = false;
+
+	Spi_collisions = 0;
+	Spi_early      = 0;
+	Spi_stalls     = 0;
+}
+
+static void Card_Queue(
+	uint8_t val)
+{
+	Card_in[Card_in_len++] = val;
+}
+
+static void check(
+	bool       ok,
+	const char *what,
+	unsigned   len)
+{
+	if (!ok && ++failures <= 10)
+	{
+		printf("%s len=%u: mismatch\n", what, len);
+	}
+}
+
+static void check_port(
+	const char *what,
+	unsigned   len)
+{
+	if ((Spi_collisions || Spi_early || Spi_stalls) && ++failures <= 10)
+	{
+		printf("%s len=%u: %lu collisions, %lu early reads, %lu stalls\n",
+			what, len, Spi_collisions, Spi_early, Spi_stalls);
+	}
+}
+
+static void check_receive(
+	unsigned len)
+{
+	BYTE     buff[512 + 1];
+	uint16_t i;
+	bool     ok;
+	int      res;
+
+	Card_Reset();
+	Card_Queue(0xFF);
+	Card_Queue(0xFF);
+	Card_Queue(0xFE);
+	for (i = 0; i < len; ++i)
+	{
+		Card_Queue(i * 13 + 7);
+	}
+	Card_Queue(0xC1);
+	Card_Queue(0xC2);
+
+	memset(buff, 0x55, sizeof(buff));
+	res = rcvr_datablock(buff, len);
+
+	ok = (res == 1) && (buff[len] == 0x55) && (Card_clocked == Card_in_len);
+	for (i = 0; i < len; ++i)
+	{
+		ok = ok && (buff[i] == (uint8_t) (i * 13 + 7));
+	}
+	for (i = 0; i < Card_clocked; ++i)
+	{
+		ok = ok && (Card_out[i] == 0xFF);
+	}
+
+	check(ok, "receive", len);
+	check_port("receive", len);
+}
+
+static void check_transmit(
+	BYTE resp)
+{
+	BYTE     buff[512];
+	uint16_t i;
+	bool     ok;
+	int      res;
+
+	for (i = 0; i < sizeof(buff); ++i)
+	{
+		buff[i] = i * 5 + 1;
+	}
+
+	// Two bytes for wait_ready, then the token, data and CRC, then the
+	// data response
+	Card_Reset();
+	for (i = 0; i < 2 + 1 + 512 + 2; ++i)
+	{
+		Card_Queue(0xFF);
+	}
+	Card_Queue(resp);
+
+	res = xmit_datablock(buff, 0xFC);
+
+	ok = (res == ((resp & 0x1F) == 0x05)) && (Card_clocked == Card_in_len);
+	ok = ok && (Card_out[2] == 0xFC);
+	for (i = 0; i < 512; ++i)
+	{
+		ok = ok && (Card_out[3 + i] == buff[i]);
+	}
+	ok = ok && (Card_out[515] == 0xFF) && (Card_out[516] == 0xFF);
+
+	check(ok, "transmit", 512);
+	check_port("transmit", 512);
+}
+
+static void check_stop(void)
+{
+	bool ok;
+	int  res;
+
+	Card_Reset();
+	Card_Queue(0xFF);
+	Card_Queue(0xFF);
+
+	res = xmit_datablock(0, 0xFD);
+
+	ok = (res == 1) && (Card_clocked == 3) && (Card_out[2] == 0xFD);
+
+	check(ok, "stop", 0);
+	check_port("stop", 0);
+}
+
+static void Emu_Reset(void)
+{
+	Card_Reset();
+	Card_emulated = true;
+
+	Emu_state = EMU_IDLE;
+	Emu_head  = Emu_tail = 0;
+	Emu_busy  = 0;
+
+	Emu_cmd24  = 0;
+	Emu_cmd25  = 0;
+	Emu_blocks = 0;
+	Emu_stops  = 0;
+	Emu_errors = 0;
+
+	memset(Emu_image, 0, sizeof(Emu_image));
+
+	Stat      = 0;
+	CardType  = CT_SD2 | CT_BLOCK;
+	WriteOpen = 0;
+	PORTB     = 1;
+}
+
+static void Emu_Fill(
+	BYTE  *buff,
+	DWORD sector,
+	BYTE  count)
+{
+	uint16_t i;
+
+	for (i = 0; i < 512 * count; ++i)
+	{
+		buff[i] = (sector + i / 512) * 7 + i * 3;
+	}
+}
+
+static bool Emu_Holds(
+	DWORD sector,
+	BYTE  count)
+{
+	BYTE buff[512];
+
+	for (; count; --count, ++sector)
+	{
+		Emu_Fill(buff, sector, 1);
+		if (memcmp(Emu_image[sector % EMU_SECTORS], buff, 512))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool Emu_Write(
+	DWORD sector,
+	BYTE  count)
+{
+	BYTE buff[512 * 2];
+
+	Emu_Fill(buff, sector, count);
+	return disk_write(0, buff, sector, count) == RES_OK;
+}
+
+static void check_emu(
+	const char    *what,
+	bool          ok,
+	unsigned long cmd25,
+	unsigned long blocks,
+	unsigned long stops)
+{
+	ok = ok && (Emu_cmd24 == 0) && (Emu_cmd25 == cmd25) &&
+	     (Emu_blocks == blocks) && (Emu_stops == stops) && (Emu_errors == 0);
+
+	if (!ok && ++failures <= 10)
+	{
+		printf("%s: %lu CMD24, %lu CMD25, %lu blocks, %lu stops, %lu errors\n",
+			what, Emu_cmd24, Emu_cmd25, Emu_blocks, Emu_stops, Emu_errors);
+	}
+	check_port(what, 512);
+}
+
+// Consecutive sectors, one and two at a time, go out as one write that
+// stays open until the sync
+static void check_write_run(void)
+{
+	bool ok;
+
+	Emu_Reset();
+	ok = Emu_Write(10, 1) && Emu_Write(11, 1) && Emu_Write(12, 2) && Emu_Write(14, 1);
+	check_emu("write run", ok && WriteOpen, 1, 5, 0);
+
+	ok = ok && (disk_ioctl(0, CTRL_SYNC, 0) == RES_OK);
+	check_emu("write run, sync", ok && !WriteOpen && Emu_Holds(10, 5), 1, 5, 1);
+}
+
+// A write elsewhere and a read each close the open write first
+static void check_write_break(void)
+{
+	BYTE buff[512], expect[512];
+	bool ok;
+
+	Emu_Reset();
+	ok = Emu_Write(20, 1) && Emu_Write(22, 1) && Emu_Write(23, 1);
+	check_emu("write gap", ok, 2, 3, 1);
+
+	ok = ok && (disk_read(0, buff, 20, 1) == RES_OK);
+	Emu_Fill(expect, 20, 1);
+	ok = ok && !memcmp(buff, expect, 512) && !WriteOpen;
+	check_emu("write, read", ok && Emu_Holds(22, 2), 2, 3, 2);
+
+	ok = ok && Emu_Write(21, 1) && Emu_Write(22, 1);
+	check_emu("read, write", ok, 3, 5, 2);
+}
+
+// A rejected block fails the write and stops it
+static void check_write_reject(void)
+{
+	bool ok;
+
+	Emu_Reset();
+	ok = Emu_Write(30, 1);
+	Emu_reject = 1;
+	ok = ok && !Emu_Write(31, 1) && !WriteOpen;
+	ok = ok && Emu_Write(31, 1);
+	check_emu("write reject", ok, 2, 2, 1);
+}
+
+int main(void)
+{
+	unsigned long checks = 0;
+	unsigned len;
+
+	for (len = 1; len <= 512; ++len)
+	{
+		check_receive(len);
+		++checks;
+	}
+
+	check_transmit(0xE5);
+	check_transmit(0x0B);
+	check_stop();
+	checks += 3;
+
+	check_write_run();
+	check_write_break();
+	check_write_reject();
+	checks += 3;
+
+	printf("%lu checks, %lu failures\n", checks, failures);
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
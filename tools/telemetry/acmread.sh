@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Live telemetry reader for a FlySight built with USE_TELEMETRY_INTERFACE
+# (Linux).
+#
+# usage: acmread.sh [DEVICE] [OUTFILE]
+#
+# Opens the CDC ACM port (default /dev/ttyACM0), which makes the unit send
+# the CSV header, then copies rows to OUTFILE (default stdout). Once per
+# second, it reports the row rate and the time of the latest row on stderr.
+
+dev=${1:-/dev/ttyACM0}
+out=${2:-/dev/stdout}
+
+if [ ! -c "$dev" ]; then
+	echo "usage: $0 [DEVICE] [OUTFILE]" >&2
+	exit 1
+fi
+
+# Raw mode, so that rows arrive unmodified. Setting the line encoding is
+# what tells the unit that a reader is present.
+stty -F "$dev" 115200 raw -echo
+
+tr -d '\r' < "$dev" | awk -F, -v out="$out" '
+	{ print > out; fflush(out) }
+	NR > 2 { n++; last = $1 }
+	{
+		t = systime()
+		if (t != prev) {
+			if (prev) printf("%d rows/s, last %s\n", n, last) > "/dev/stderr"
+			n = 0; prev = t
+		}
+	}'
@@ -0,0 +1,174 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Counts AVR cycles spent by the ToneFill generators and by the loops they
+// replaced, filling the circular buffer in chunks as Tone_Task does during a
+// beep or WAV. Built for an ATmega644, which has the same AVR core as the
+// AT90USB646, and run under simavr. Results are printed on the simavr
+// console. CPU load assumes 7812.5 samples/s at 8 MHz, i.e. 1024 cycles per
+// sample.
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <stdint.h>
+
+#include "avr_mcu_section.h"
+
+#include "ToneFill.h"
+#include "tonefill_ref.h"
+
+AVR_MCU(F_CPU, "atmega644");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define CHUNK  (REF_BUFFER_LEN / 8)
+#define ROUNDS 16
+
+static uint8_t  New_buffer[REF_BUFFER_LEN];
+static uint16_t New_write;
+
+static void Bench_WriteString(
+	const char *str)
+{
+	char ch;
+
+	while ((ch = pgm_read_byte(str++)) != 0)
+	{
+		GPIOR0 = ch;
+	}
+}
+
+static void Bench_WriteNumber(
+	uint32_t val)
+{
+	char buf[11];
+	char *ptr = buf + sizeof(buf);
+
+	*--ptr = 0;
+	do
+	{
+		*--ptr = '0' + val % 10;
+		val /= 10;
+	}
+	while (val);
+
+	while (*ptr)
+	{
+		GPIOR0 = *ptr++;
+	}
+}
+
+// Reports cycles per sample to one decimal and the resulting CPU load
+static void Bench_Report(
+	const char *name,
+	uint32_t   cycles)
+{
+	uint32_t tenths = cycles * 10 / ((uint32_t) ROUNDS * CHUNK);
+
+	Bench_WriteString(name);
+	Bench_WriteNumber(tenths / 10);
+	GPIOR0 = '.';
+	Bench_WriteNumber(tenths % 10);
+	Bench_WriteString(PSTR(" cycles/sample, CPU "));
+	Bench_WriteNumber(tenths * 100 / 1024 / 10);
+	GPIOR0 = '.';
+	Bench_WriteNumber(tenths * 100 / 1024 % 10);
+	Bench_WriteString(PSTR("%\n"));
+}
+
+static inline void Bench_Start(void)
+{
+	TCCR1A = 0;
+	TCCR1B = (1 << CS10);
+	TCNT1  = 0;
+}
+
+static inline uint16_t Bench_Stop(void)
+{
+	return TCNT1;
+}
+
+static void Bench_Volume(
+	uint8_t volume)
+{
+	ToneFill_osc_t   osc = { 0, 30212096UL * 4, 1000 };
+	ToneFill_scale_t scale;
+	uint32_t ref_beep = 0, new_beep = 0, ref_wav = 0, new_wav = 0;
+	uint8_t  round;
+
+	Ref_step   = osc.step;
+	Ref_chirp  = osc.chirp;
+	Ref_volume = volume;
+
+	ToneFill_SetScale(&scale, volume);
+
+	for (round = 0; round < ROUNDS; ++round)
+	{
+		uint16_t offset = New_write % REF_BUFFER_LEN;
+
+		Bench_Start();
+		Ref_LoadTable(CHUNK);
+		ref_beep += Bench_Stop();
+
+		Bench_Start();
+		ToneFill_Sine(&New_buffer[offset], CHUNK, &osc, &scale);
+		new_beep += Bench_Stop();
+
+		Ref_write -= CHUNK;
+
+		Bench_Start();
+		Ref_ScaleFile(CHUNK);
+		ref_wav += Bench_Stop();
+
+		Bench_Start();
+		ToneFill_Scale(&New_buffer[offset], CHUNK, &scale);
+		new_wav += Bench_Stop();
+
+		New_write += CHUNK;
+	}
+
+	Bench_WriteString(PSTR("Volume "));
+	Bench_WriteNumber(volume);
+	Bench_WriteString(PSTR("\n"));
+	Bench_Report(PSTR("  beep, before: "), ref_beep);
+	Bench_Report(PSTR("  beep, after:  "), new_beep);
+	Bench_Report(PSTR("  wav, before:  "), ref_wav);
+	Bench_Report(PSTR("  wav, after:   "), new_wav);
+}
+
+int main(void)
+{
+	uint8_t volume;
+
+	for (volume = 0; volume < 8; ++volume)
+	{
+		Bench_Volume(volume);
+	}
+
+	// Stop the simulation
+	cli();
+	sleep_mode();
+
+	return 0;
+}
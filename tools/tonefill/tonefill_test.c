@@ -0,0 +1,236 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Tom van Dijck                          **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Compares the ToneFill generators with the loops they replaced, for every
+// volume, a sweep of pitches and chirps, and fills of varying size that
+// wrap around the circular buffer. Glides are compared with a plain
+// per-sample model, with the target pitch moving between fills.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ToneFill.h"
+#include "tonefill_ref.h"
+
+#define TONE_SAMPLE_LEN    4
+#define TONE_LENGTH_125_MS 3906
+#define TONE_MAX_PITCH     65280
+#define TONE_CHIRP_MAX     (((uint32_t) 3242 << 16) / TONE_LENGTH_125_MS)
+#define TONE_GLIDE_RANGE   ((uint32_t) TONE_MAX_PITCH * 3242 / 125 * 64)
+
+static uint8_t  New_buffer[REF_BUFFER_LEN];
+static uint16_t New_write;
+
+static unsigned long failures = 0;
+
+// Same split as Tone_LoadTable
+static void New_LoadTable(
+	uint16_t         size,
+	ToneFill_osc_t   *osc,
+	ToneFill_scale_t *scale)
+{
+	uint16_t offset = New_write % REF_BUFFER_LEN;
+	uint16_t run = REF_BUFFER_LEN - offset;
+
+	if (run > size) run = size;
+
+	ToneFill_Sine(&New_buffer[offset], run, osc, scale);
+	ToneFill_Sine(New_buffer, size - run, osc, scale);
+
+	New_write += size;
+}
+
+static void check_beep(
+	uint8_t  volume,
+	uint16_t index,
+	uint32_t chirp)
+{
+	ToneFill_osc_t   osc;
+	ToneFill_scale_t scale;
+	uint16_t len = TONE_LENGTH_125_MS / TONE_SAMPLE_LEN;
+	uint16_t start = rand();
+
+	osc.phase = Ref_phase = rand();
+	osc.step  = Ref_step  = ((int32_t) index * 3242 + 30212096) * TONE_SAMPLE_LEN;
+	osc.chirp = Ref_chirp = chirp * TONE_SAMPLE_LEN * TONE_SAMPLE_LEN;
+	osc.slew  = 0;
+	Ref_len   = len;
+	Ref_volume = volume;
+	New_write = Ref_write = start;
+
+	ToneFill_SetScale(&scale, volume);
+
+	while (len)
+	{
+		uint16_t size = 1 + rand() % REF_BUFFER_LEN;
+
+		if (size > len) size = len;
+		len -= size;
+
+		Ref_LoadTable(size);
+		New_LoadTable(size, &osc, &scale);
+
+		if (memcmp(Ref_buffer, New_buffer, REF_BUFFER_LEN)
+			|| Ref_phase != osc.phase || Ref_step != osc.step)
+		{
+			if (++failures <= 10)
+			{
+				printf("beep volume=%u index=%u chirp=%lu: mismatch\n",
+					volume, index, (unsigned long) chirp);
+			}
+			return;
+		}
+	}
+}
+
+static uint32_t step_of(
+	uint16_t index)
+{
+	return ((int32_t) index * 3242 + 30212096) * TONE_SAMPLE_LEN;
+}
+
+static void check_glide(
+	uint8_t  volume,
+	uint32_t slew)
+{
+	ToneFill_osc_t   osc;
+	ToneFill_scale_t scale;
+	uint8_t  buffer[REF_BUFFER_LEN];
+	uint16_t phase = rand();
+	uint32_t step = step_of(rand() % TONE_MAX_PITCH);
+	uint16_t len = TONE_LENGTH_125_MS / TONE_SAMPLE_LEN;
+	uint16_t i;
+
+	osc.phase = phase;
+	osc.step  = step;
+	osc.chirp = 0;
+	osc.slew  = slew;
+
+	ToneFill_SetScale(&scale, volume);
+
+	while (len)
+	{
+		uint16_t size = 1 + rand() % REF_BUFFER_LEN;
+		int64_t  diff;
+
+		if (size > len) size = len;
+		len -= size;
+
+		osc.target = step_of(rand() % TONE_MAX_PITCH);
+		ToneFill_Sine(buffer, size, &osc, &scale);
+
+		for (i = 0; i < size; ++i)
+		{
+			uint8_t val = Ref_sine_table[phase >> 8];
+
+			val = 128 - (128 >> volume) + (val >> volume);
+			phase += step >> 16;
+
+			diff = (int64_t) osc.target - step;
+			if (diff > (int64_t) slew) diff = slew;
+			if (diff < -(int64_t) slew) diff = -(int64_t) slew;
+			step += diff;
+
+			if (buffer[i] != val)
+			{
+				if (++failures <= 10)
+				{
+					printf("glide volume=%u slew=%lu: mismatch\n",
+						volume, (unsigned long) slew);
+				}
+				return;
+			}
+		}
+
+		if (phase != osc.phase || step != osc.step)
+		{
+			if (++failures <= 10)
+			{
+				printf("glide volume=%u slew=%lu: state mismatch\n",
+					volume, (unsigned long) slew);
+			}
+			return;
+		}
+	}
+}
+
+static void check_wav(
+	uint8_t volume)
+{
+	ToneFill_scale_t scale;
+	uint16_t i;
+
+	for (i = 0; i < REF_BUFFER_LEN; ++i)
+	{
+		Ref_buffer[i] = New_buffer[i] = i;
+	}
+
+	Ref_volume = volume;
+	Ref_write = 0;
+	ToneFill_SetScale(&scale, volume);
+
+	Ref_ScaleFile(REF_BUFFER_LEN);
+	ToneFill_Scale(New_buffer, REF_BUFFER_LEN, &scale);
+
+	if (memcmp(Ref_buffer, New_buffer, REF_BUFFER_LEN))
+	{
+		if (++failures <= 10)
+		{
+			printf("wav volume=%u: mismatch\n", volume);
+		}
+	}
+}
+
+int main(void)
+{
+	unsigned long checks = 0;
+	uint8_t  volume;
+	uint32_t index, chirp, slew;
+
+	for (volume = 0; volume < 8; ++volume)
+	{
+		check_wav(volume);
+		++checks;
+
+		for (slew = 1; slew <= TONE_GLIDE_RANGE; slew *= 3)
+		{
+			check_glide(volume, slew);
+			++checks;
+		}
+
+		for (index = 0; index <= TONE_MAX_PITCH; index += 1020)
+		{
+			for (chirp = 0; chirp <= TONE_CHIRP_MAX; chirp += TONE_CHIRP_MAX / 8)
+			{
+				check_beep(volume, index, chirp);
+				++checks;
+			}
+		}
+	}
+
+	printf("%lu checks, %lu failures\n", checks, failures);
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
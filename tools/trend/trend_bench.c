@@ -0,0 +1,80 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Times Trend_Update against the central difference it replaced on the
+// host. Host timings only give a rough ratio; on the AVR, the reference
+// spends most of its time in its two software 32-bit divisions, which
+// Trend_Update does not have.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "Trend.h"
+#include "trend_ref.h"
+
+#define UPDATES 20000000L
+
+static volatile int32_t sink;
+
+// A glide ratio wandering between 1 and 3 at 5 Hz
+static int32_t value(
+	long i)
+{
+	return 20000 + ((i * 7919) % 20001) - 10000;
+}
+
+int main(void)
+{
+	Ref_central_t ref;
+	Trend_t trend;
+	int32_t rate = 0;
+	clock_t start;
+	double t_ref, t_new;
+	long i;
+
+	Ref_CentralReset(&ref);
+	start = clock();
+	for (i = 0; i < UPDATES; ++i)
+	{
+		sink = Ref_CentralUpdate(&ref, value(i), 200 * i, 0, 30000);
+	}
+	t_ref = (double) (clock() - start) / CLOCKS_PER_SEC * 1e9 / UPDATES;
+
+	memset(&trend, 0, sizeof(trend));
+	start = clock();
+	for (i = 0; i < UPDATES; ++i)
+	{
+		Trend_Configure(&trend, 0, 30000, 200);
+		Trend_Update(&trend, value(i), 200 * i, 30 + (i & 31), &rate);
+		sink = rate;
+	}
+	t_new = (double) (clock() - start) / CLOCKS_PER_SEC * 1e9 / UPDATES;
+
+	printf("central difference: %8.1f ns/update\n", t_ref);
+	printf("alpha-beta filter:  %8.1f ns/update\n", t_new);
+	printf("ratio:              %8.2fx\n", t_ref / t_new);
+
+	return 0;
+}
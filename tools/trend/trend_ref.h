@@ -0,0 +1,80 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+#ifndef TREND_REF_H
+#define TREND_REF_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define REF_INVALID INT32_MAX
+
+// The Mode_2 = 9 rate as UBX_UpdateTones computed it before Trend.c: the
+// change across the last three values, in percent * 100 of the range per
+// second, with two 32-bit divisions per update
+
+typedef struct
+{
+	int32_t  x0, x1, x2;
+	uint32_t t0, t1, t2;
+}
+Ref_central_t;
+
+static void Ref_CentralReset(
+	Ref_central_t *ref)
+{
+	ref->x0 = ref->x1 = ref->x2 = REF_INVALID;
+	ref->t0 = ref->t1 = ref->t2 = 0;
+}
+
+static int32_t Ref_CentralUpdate(
+	Ref_central_t *ref,
+	int32_t  val,
+	uint32_t time,
+	int32_t  min,
+	int32_t  max)
+{
+	int32_t rate;
+
+	ref->x2 = ref->x1;
+	ref->x1 = ref->x0;
+	ref->x0 = val;
+
+	ref->t2 = ref->t1;
+	ref->t1 = ref->t0;
+	ref->t0 = time;
+
+	if (ref->x0 == REF_INVALID ||
+	    ref->x1 == REF_INVALID ||
+	    ref->x2 == REF_INVALID ||
+	    max == min ||
+	    ref->t0 == ref->t2)
+	{
+		return REF_INVALID;
+	}
+
+	rate = (int32_t) 1000 * (ref->x2 - ref->x0) / (int32_t) (ref->t0 - ref->t2);
+	return (int32_t) 10000 * labs(rate) / labs(max - min);
+}
+
+#endif
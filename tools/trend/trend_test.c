@@ -0,0 +1,482 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Compares the Mode_2 = 9 rate from Trend_Update with the three-sample
+// central difference it replaced, for horizontal speed, vertical speed
+// and glide ratio as Value 1.
+//
+// Usage: trend_test [-r rate] [track.csv ...]
+//
+// Recorded tracks are measured against a centred least squares slope over
+// one second of the track itself. Without files, a synthetic swoop is
+// replayed at the given measurement rate (ms, default 200) and measured
+// against its exact rate of change. Either way, rates are compared while
+// the vertical speed is above the default V_Thresh, when tones play.
+//
+// The filter is also checked against a steady ramp, which it must follow
+// exactly, and for a reset after a gap. Those failures set the exit code.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Trend.h"
+#include "trend_ref.h"
+
+#define LINE_LEN   512
+#define MAX_FIELDS 32
+#define THRESHOLD  1000 // Smallest vertical speed compared (cm/s)
+#define FIT_WINDOW 500  // Half width of the reference slope (ms)
+
+typedef struct
+{
+	uint32_t time;   // Time since the first sample (ms)
+	int32_t  velD;   // Down velocity (cm/s)
+	int32_t  gSpeed; // Ground speed  (cm/s)
+	uint32_t sAcc;   // Speed accuracy estimate (cm/s)
+	int      fix;    // Fix type
+	double   truth[3]; // Exact rate of change of each mode, if known
+}
+sample_t;
+
+typedef struct
+{
+	const char *name;
+	int32_t     min;  // Range as UBX_GetValues passes it for Value 1
+	int32_t     max;
+}
+mode_info_t;
+
+static const mode_info_t modes[] =
+{
+	{ "Horizontal speed", 0, 3000  },
+	{ "Vertical speed",   0, 3000  },
+	{ "Glide ratio",      0, 30000 }
+};
+
+#define NUM_MODES (sizeof(modes) / sizeof(mode_info_t))
+
+static sample_t *samples;
+static size_t num_samples, max_samples;
+static int have_truth = 0;
+
+static unsigned long failures = 0;
+
+static sample_t *add_sample(void)
+{
+	if (num_samples == max_samples)
+	{
+		max_samples = max_samples ? 2 * max_samples : 1024;
+		samples = realloc(samples, max_samples * sizeof(sample_t));
+		if (!samples)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+
+	return memset(samples + num_samples++, 0, sizeof(sample_t));
+}
+
+// Value 1 as in UBX_GetValues, without the airspeed correction
+
+static int value(
+	int      mode,
+	double   velD,
+	double   gSpeed,
+	int32_t *val)
+{
+	switch (mode)
+	{
+	case 0:
+		*val = lround(gSpeed);
+		return 1;
+	case 1:
+		*val = lround(velD);
+		return 1;
+	default:
+		if (lround(velD) == 0) return 0;
+		*val = 10000 * (int32_t) lround(gSpeed) / (int32_t) lround(velD);
+		return 1;
+	}
+}
+
+static int split(
+	char *line,
+	char **fields)
+{
+	int n = 0;
+
+	line[strcspn(line, "\r\n")] = 0;
+	fields[n++] = line;
+
+	while (n < MAX_FIELDS && (line = strchr(line, ',')))
+	{
+		*line++ = 0;
+		fields[n++] = line;
+	}
+
+	return n;
+}
+
+static int find_field(
+	char **fields,
+	int n,
+	const char *name)
+{
+	int i;
+
+	for (i = 0; i < n; ++i)
+	{
+		if (!strcmp(fields[i], name)) return i;
+	}
+
+	fprintf(stderr, "Missing column %s\n", name);
+	exit(1);
+}
+
+static void read_track(
+	const char *path)
+{
+	char line[LINE_LEN], *fields[MAX_FIELDS];
+	int n, time_col, velN_col, velE_col, velD_col, sAcc_col, fix_col;
+	double day = 0, prev = 0, first = -1;
+	uint32_t offset = num_samples ? samples[num_samples - 1].time + 10000 : 0;
+	FILE *f = fopen(path, "r");
+
+	if (!f || !fgets(line, sizeof(line), f))
+	{
+		fprintf(stderr, "Can't read %s\n", path);
+		exit(1);
+	}
+
+	n = split(line, fields);
+	time_col = find_field(fields, n, "time");
+	velN_col = find_field(fields, n, "velN");
+	velE_col = find_field(fields, n, "velE");
+	velD_col = find_field(fields, n, "velD");
+	sAcc_col = find_field(fields, n, "sAcc");
+	fix_col  = find_field(fields, n, "gpsFix");
+
+	while (fgets(line, sizeof(line), f))
+	{
+		int hour, min;
+		double sec, time, velN, velE;
+		sample_t *s;
+
+		if (split(line, fields) < n) continue;
+		if (sscanf(fields[time_col], "%*d-%*d-%*dT%d:%d:%lf", &hour, &min, &sec) != 3) continue;
+
+		time = ((hour * 60 + min) * 60 + sec) * 1000 + day;
+		if (time < prev)
+		{
+			day += 86400000;
+			time += 86400000;
+		}
+		prev = time;
+		if (first < 0) first = time;
+
+		velN = atof(fields[velN_col]);
+		velE = atof(fields[velE_col]);
+
+		s = add_sample();
+		s->time   = offset + lround(time - first);
+		s->velD   = lround(atof(fields[velD_col]) * 100);
+		s->gSpeed = lround(sqrt(velN * velN + velE * velE) * 100);
+		s->sAcc   = lround(atof(fields[sAcc_col]) * 100);
+		s->fix    = atoi(fields[fix_col]);
+	}
+
+	fclose(f);
+}
+
+static double gaussian(void)
+{
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double pulse(
+	double t,
+	double start,
+	double end)
+{
+	double s;
+
+	if (t < start || t >= end) return 0;
+
+	s = sin(M_PI * (t - start) / (end - start));
+	return s * s;
+}
+
+// Velocities of a minute under canopy: three diving turns, each followed
+// by a swoop that bleeds off vertical speed into horizontal speed (cm/s)
+
+static void swoop(
+	double time,
+	double *velD,
+	double *gSpeed)
+{
+	double phase = fmod(time, 20000) / 1000;
+
+	*velD   = 1200 + 1400 * pulse(phase, 0, 7) - 600 * pulse(phase, 5, 12);
+	*gSpeed = 1200 +  600 * pulse(phase, 0, 6) + 1000 * pulse(phase, 4, 12);
+}
+
+// The swoop at the given rate, with 0.15 m/s of noise and the 0.3 m/s
+// sAcc a receiver typically reports for it
+
+static void synthetic_track(
+	uint16_t rate)
+{
+	uint32_t t;
+	int mode;
+
+	srand(1);
+	have_truth = 1;
+
+	for (t = 0; t < 60000; t += rate)
+	{
+		sample_t *s = add_sample();
+		double velD, gSpeed, velD2, gSpeed2;
+
+		swoop(t, &velD, &gSpeed);
+		swoop(t + 1, &velD2, &gSpeed2);
+
+		s->time   = t;
+		s->velD   = lround(velD + 15 * gaussian());
+		s->gSpeed = lround(hypot(gSpeed + 15 * gaussian(), 15 * gaussian()));
+		s->sAcc   = 30;
+		s->fix    = 3;
+
+		for (mode = 0; mode < NUM_MODES; ++mode)
+		{
+			double x0 = mode == 0 ? gSpeed : mode == 1 ? velD : 10000 * gSpeed / velD;
+			double x1 = mode == 0 ? gSpeed2 : mode == 1 ? velD2 : 10000 * gSpeed2 / velD2;
+
+			s->truth[mode] = (x1 - x0) * 1000;
+		}
+	}
+}
+
+// Least squares slope of Value 1 over FIT_WINDOW either side of sample i
+// (units per second), or NAN if the track has a gap there
+
+static double fitted_rate(
+	int mode,
+	size_t i)
+{
+	double st = 0, sx = 0, stt = 0, stx = 0;
+	size_t j, first = i, last = i;
+	int n = 0;
+	int32_t val;
+
+	while (first > 0 && samples[i].time - samples[first - 1].time <= FIT_WINDOW) --first;
+	while (last + 1 < num_samples && samples[last + 1].time - samples[i].time <= FIT_WINDOW) ++last;
+
+	if (samples[i].time - samples[first].time < FIT_WINDOW / 2) return NAN;
+	if (samples[last].time - samples[i].time < FIT_WINDOW / 2) return NAN;
+
+	for (j = first; j <= last; ++j)
+	{
+		double t = (double) samples[j].time - samples[i].time;
+
+		if (samples[j].fix != 3 || !value(mode, samples[j].velD, samples[j].gSpeed, &val)) return NAN;
+
+		st  += t;
+		sx  += val;
+		stt += t * t;
+		stx += t * val;
+		++n;
+	}
+
+	return (n * stx - st * sx) / (n * stt - st * st) * 1000;
+}
+
+static void compare(
+	int mode,
+	uint16_t interval)
+{
+	const mode_info_t *m = modes + mode;
+	Ref_central_t ref;
+	Trend_t trend;
+	double sum_ref = 0, sum_new = 0, worst_ref = 0, worst_new = 0;
+	unsigned long count = 0;
+	size_t i;
+
+	memset(&trend, 0, sizeof(trend));
+	Ref_CentralReset(&ref);
+
+	for (i = 0; i < num_samples; ++i)
+	{
+		const sample_t *s = samples + i;
+		int32_t val, rate_ref, rate_new;
+		double truth, e0, e1;
+		uint8_t ok;
+
+		if (s->fix != 3 || !value(mode, s->velD, s->gSpeed, &val))
+		{
+			Ref_CentralReset(&ref);
+			Trend_Reset(&trend);
+			continue;
+		}
+
+		rate_ref = Ref_CentralUpdate(&ref, val, s->time, m->min, m->max);
+
+		Trend_Configure(&trend, m->min, m->max, interval);
+		ok = Trend_Update(&trend, val, s->time, s->sAcc, &rate_new);
+
+		if (!ok || rate_ref == REF_INVALID || labs(s->velD) < THRESHOLD) continue;
+
+		truth = have_truth ? s->truth[mode] : fitted_rate(mode, i);
+		if (isnan(truth)) continue;
+
+		truth = fabs(truth) * 10000 / (m->max - m->min);
+
+		e0 = fabs(rate_ref - truth);
+		e1 = fabs(rate_new - truth);
+
+		sum_ref += e0 * e0;
+		sum_new += e1 * e1;
+		if (e0 > worst_ref) worst_ref = e0;
+		if (e1 > worst_new) worst_new = e1;
+		++count;
+	}
+
+	if (!count)
+	{
+		printf("%-18s no rates compared\n", m->name);
+		return;
+	}
+
+	sum_ref = sqrt(sum_ref / count) / 100;
+	sum_new = sqrt(sum_new / count) / 100;
+
+	printf("%-18s %7lu %10.2f %10.2f %8.1f%% %10.2f %10.2f\n",
+		m->name, count, sum_ref, sum_new,
+		100 * (sum_new - sum_ref) / sum_ref,
+		worst_ref / 100, worst_new / 100);
+}
+
+// A steady ramp is followed exactly once the filter has settled, and a
+// gap of more than TREND_MAX_GAP intervals restarts it
+
+static void check_filter(void)
+{
+	Trend_t trend;
+	int32_t rate = 0;
+	uint32_t t;
+	uint8_t ok = 0;
+
+	memset(&trend, 0, sizeof(trend));
+	Trend_Configure(&trend, 0, 3000, 200);
+
+	// 150 cm/s per second is 5% of the range, or 500 percent * 100
+	for (t = 0; t <= 20000; t += 200)
+	{
+		ok = Trend_Update(&trend, 1000 + 150 * t / 1000, t, 30, &rate);
+	}
+
+	if (!ok || labs(rate - 500) > 1)
+	{
+		printf("Ramp: rate %ld, expected 500\n", (long) rate);
+		++failures;
+	}
+
+	if (Trend_Update(&trend, 1000, t + 200 * (TREND_MAX_GAP + 1), 30, &rate))
+	{
+		printf("Gap: filter was not restarted\n");
+		++failures;
+	}
+
+	// Rates far beyond the range saturate rather than overflow
+	Trend_Reset(&trend);
+	for (t = 0; t <= 2000; t += 200)
+	{
+		ok = Trend_Update(&trend, (t / 200) & 1 ? -2000000000 : 2000000000, t, 1, &rate);
+	}
+
+	if (!ok || rate <= 0)
+	{
+		printf("Saturation: rate %ld\n", (long) rate);
+		++failures;
+	}
+}
+
+int main(
+	int  argc,
+	char *argv[])
+{
+	uint16_t rate = 200, interval;
+	size_t mode;
+	int i;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-r") && i + 1 < argc)
+		{
+			rate = atoi(argv[++i]);
+		}
+		else
+		{
+			read_track(argv[i]);
+		}
+	}
+
+	check_filter();
+
+	if (num_samples == 0)
+	{
+		printf("Synthetic swoop at %u ms\n", rate);
+		synthetic_track(rate);
+		interval = rate;
+	}
+	else
+	{
+		// Nominal interval of the recorded tracks
+
+		interval = num_samples > 1 ? samples[1].time - samples[0].time : rate;
+		for (i = 2; i < num_samples && i < 100; ++i)
+		{
+			uint16_t dt = samples[i].time - samples[i - 1].time;
+			if (dt < interval) interval = dt;
+		}
+		printf("Recorded tracks at %u ms\n", interval);
+	}
+
+	printf("\nRMS and largest error in the rate (percent of range per second)\n\n");
+	printf("%-18s %7s %10s %10s %9s %10s %10s\n", "Value 1", "rates", "central", "filter", "change", "central", "filter");
+
+	for (mode = 0; mode < NUM_MODES; ++mode)
+	{
+		compare(mode, interval);
+	}
+
+	printf("\n%lu filter check failures\n", failures);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Converts a binary track (.trk) written with Log_Track = 2 to the CSV 
+// format written with Log_Track = 1.
+//
+// Usage: trk2csv input.trk [output.csv]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Track.h"
+
+static_assert(sizeof(Track_header_t) == 28, "unexpected header size");
+static_assert(sizeof(Track_key_t) == sizeof(Track_record_t), "unexpected key size");
+
+// Same output as Log_WriteInt32ToBuf, without the delimiter
+static std::string formatInt32(int32_t val, int8_t dec, int8_t dot)
+{
+	char buf[16];
+	char *ptr = buf + sizeof(buf);
+	int32_t value = val > 0 ? val : -val;
+
+	*--ptr = 0;
+	while (value > 0 || dec > 0)
+	{
+		*--ptr = value % 10 + '0';
+		value /= 10;
+		if (--dec == 0 && dot)
+		{
+			*--ptr = '.';
+		}
+	}
+	if (*ptr == '.' || *ptr == 0)
+	{
+		*--ptr = '0';
+	}
+	if (val < 0)
+	{
+		*--ptr = '-';
+	}
+
+	return ptr;
+}
+
+static std::string formatField(bool valid, int32_t val, int8_t dec)
+{
+	return valid ? formatInt32(val, dec, 1) : std::string();
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = static_cast<unsigned>(y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static void civilFromDays(int64_t z, int32_t &y, int32_t &m, int32_t &d)
+{
+	z += 719468;
+	const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	const unsigned doe = static_cast<unsigned>(z - era * 146097);
+	const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = mp < 10 ? mp + 3 : mp - 9;
+	y = static_cast<int32_t>(yoe + era * 400 + (m <= 2));
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " input.trk [output.csv]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream in(argv[1], std::ios::binary);
+	if (!in)
+	{
+		std::cerr << "Can't open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if (argc == 3)
+	{
+		file.open(argv[2], std::ios::binary);
+		if (!file)
+		{
+			std::cerr << "Can't open " << argv[2] << std::endl;
+			return 1;
+		}
+	}
+	std::ostream &out = (argc == 3) ? file : std::cout;
+
+	Track_header_t header;
+	if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+	    memcmp(header.magic, TRACK_MAGIC, sizeof(header.magic)) != 0)
+	{
+		std::cerr << argv[1] << " is not a FlySight track" << std::endl;
+		return 1;
+	}
+	if (header.version != TRACK_VERSION || 
+	    header.recordLen != sizeof(Track_record_t) ||
+	    header.headerLen < sizeof(header))
+	{
+		std::cerr << "Unsupported track version " << int(header.version) << std::endl;
+		return 1;
+	}
+
+	// Skip the firmware version
+	in.seekg(header.headerLen, std::ios::beg);
+
+	out << "time,lat,lon,hMSL,velN,velE,velD,hAcc,vAcc,sAcc,heading,cAcc,gpsFix,numSV\r\n"
+	       ",(deg),(deg),(m),(m/s),(m/s),(m/s),(m),(m),(m/s),(deg),(deg),,\r\n";
+
+	const int64_t base = daysFromCivil(header.year, header.month, header.day) * 86400 +
+		header.hour * 3600 + header.min * 60 + header.sec;
+
+	int32_t lat = 0, lon = 0, hMSL = 0;
+	uint32_t secHigh = 0;
+	uint16_t secPrev = 0;
+
+	union
+	{
+		Track_record_t rec;
+		Track_key_t    key;
+	}
+	u;
+
+	while (in.read(reinterpret_cast<char *>(&u), sizeof(u)))
+	{
+		if (u.key.flags & TRACK_KEY)
+		{
+			lat  = u.key.lat;
+			lon  = u.key.lon;
+			hMSL = u.key.hMSL;
+			continue;
+		}
+
+		const Track_record_t &rec = u.rec;
+		const bool pos = rec.flags & TRACK_POS;
+		const bool sol = rec.flags & TRACK_SOL;
+		const bool vel = rec.flags & TRACK_VEL;
+
+		if (pos)
+		{
+			lat  += rec.dLat;
+			lon  += rec.dLon;
+			hMSL += rec.dHMSL;
+		}
+
+		std::string row;
+
+		if (rec.flags & TRACK_TIME)
+		{
+			// Record times are kept modulo 65536 s
+			if (rec.sec < secPrev)
+			{
+				secHigh += 0x10000;
+			}
+			secPrev = rec.sec;
+
+			const int64_t t = base + secHigh + rec.sec;
+			int64_t days = t / 86400;
+			int32_t rem = static_cast<int32_t>(t % 86400);
+			int32_t year, month, day;
+			civilFromDays(days, year, month, day);
+
+			row += formatInt32(year,       4, 0) + '-';
+			row += formatInt32(month,      2, 0) + '-';
+			row += formatInt32(day,        2, 0) + 'T';
+			row += formatInt32(rem / 3600, 2, 0) + ':';
+			row += formatInt32(rem / 60 % 60, 2, 0) + ':';
+			row += formatInt32(rem % 60,   2, 0) + '.';
+			row += formatInt32(rec.csec,   2, 0) + 'Z';
+		}
+
+		row += ',' + formatField(pos, lat, 7);
+		row += ',' + formatField(pos, lon, 7);
+		row += ',' + formatField(pos, hMSL, 3);
+		row += ',' + formatField(vel, rec.velN, 2);
+		row += ',' + formatField(vel, rec.velE, 2);
+		row += ',' + formatField(vel, rec.velD, 2);
+		row += ',' + formatField(pos, rec.hAcc * header.hAccScale, 3);
+		row += ',' + formatField(pos, rec.vAcc * header.vAccScale, 3);
+		row += ',' + formatField(vel, rec.sAcc * header.sAccScale, 2);
+		row += ',' + formatField(vel, rec.heading * header.headScale, 5);
+		row += ',' + formatField(vel, rec.cAcc * header.cAccScale, 5);
+		row += ',' + formatField(sol, rec.gpsFix, 0);
+		row += ',' + formatField(sol, rec.numSV, 0);
+		row += "\r\n";
+
+		out << row;
+	}
+
+	return 0;
+}
@@ -0,0 +1,331 @@
+/***************************************************************************
+**                                                                        **
+**  FlySight firmware                                                     **
+**  Copyright 2018 Michael Cooper, Will Glynn                             **
+**                                                                        **
+**  This program is free software: you can redistribute it and/or modify  **
+**  it under the terms of the GNU General Public License as published by  **
+**  the Free Software Foundation, either version 3 of the License, or     **
+**  (at your option) any later version.                                   **
+**                                                                        **
+**  This program is distributed in the hope that it will be useful,       **
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of        **
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         **
+**  GNU General Public License for more details.                          **
+**                                                                        **
+**  You should have received a copy of the GNU General Public License     **
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>. **
+**                                                                        **
+****************************************************************************
+**  Contact: Michael Cooper                                               **
+**  Website: http://flysight.ca/                                          **
+****************************************************************************/
+
+// Round trip through the binary track format. Writes a .trk file the way
+// UBX_WriteTrackRecord does, converts it with trk2csv, and compares each
+// CSV field with the value that went in. Positions, velocities and times
+// must come back exactly. Heading and the accuracies must come back as the
+// value rounded and saturated as described in Track.h.
+//
+// Usage: trk2csv_test [path/to/trk2csv]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Track.h"
+
+struct Epoch
+{
+	uint8_t  hour, min, sec;
+	int32_t  nano;
+	int32_t  lat, lon, hMSL;  // deg * 1e-7, mm
+	int32_t  velN, velE, velD; // cm/s
+	uint32_t hAcc, vAcc;      // mm
+	uint32_t sAcc;            // cm/s
+	int32_t  heading;         // deg * 1e-5
+	uint32_t cAcc;            // deg * 1e-5
+	uint8_t  gpsFix, numSV;
+};
+
+static unsigned long checks = 0, failures = 0;
+
+// Same rounding and saturation as UBX_Scale8
+static uint8_t scale8(uint32_t val, uint32_t scale)
+{
+	if (val > (uint32_t) UINT8_MAX * scale)
+	{
+		return UINT8_MAX;
+	}
+	return (val + scale / 2) / scale;
+}
+
+// Value expected back from trk2csv for an accuracy: the nearest step, or the
+// cap when the byte saturates
+static uint32_t expectAcc(uint32_t val, uint32_t scale)
+{
+	uint64_t q = ((uint64_t) val + scale / 2) / scale;
+	return (q > UINT8_MAX ? UINT8_MAX : q) * scale;
+}
+
+static void check(int row, const char *name, int64_t expected, int64_t actual)
+{
+	++checks;
+	if (expected != actual && failures++ < 20)
+	{
+		printf("Row %d %s: expected %lld, got %lld\n", row, name,
+			(long long) expected, (long long) actual);
+	}
+}
+
+static std::vector<Epoch> makeEpochs(void)
+{
+	// Accuracies on and between steps, just below and above the cap, and the
+	// receiver's "unknown" value
+	static const uint32_t hAcc[] =
+	{
+		0, 49, 50, 1234, 1250, 1349, 25449, 25450, 25500, 25549, 25550,
+		100000, 4294967295u
+	};
+	static const uint32_t sAcc[] =
+	{
+		0, 1, 37, 254, 255, 256, 1000, 4294967295u
+	};
+	static const uint32_t cAcc[] =
+	{
+		0, 4999, 5000, 123456, 2549999, 2550000, 2555000, 18000000, 4294967295u
+	};
+
+	std::vector<Epoch> epochs;
+	Epoch e;
+	size_t i;
+
+	memset(&e, 0, sizeof(e));
+	e.hour = 23;
+	e.min  = 59;
+	e.sec  = 55;
+	e.lat  = 491234567;
+	e.lon  = -1231234567;
+	e.hMSL = 1234567;
+	e.gpsFix = 3;
+	e.numSV  = 9;
+
+	for (i = 0; i < 40; ++i)
+	{
+		e.nano    = (i % 5) * 200000000;
+		e.lat    += (i % 7 == 3) ? 40000 : 123 * (int32_t) i;   // some need key records
+		e.lon    -= 77 * (int32_t) i;
+		e.hMSL   -= (i == 20) ? 100000 : 5000;
+		e.velN    = 1000 - 61 * (int32_t) i;
+		e.velE    = (i == 11) ? -32768 : 250 + (int32_t) i;
+		e.velD    = 5000 + 7 * (int32_t) i;
+		e.hAcc    = hAcc[i % (sizeof(hAcc) / sizeof(hAcc[0]))];
+		e.vAcc    = hAcc[(i + 5) % (sizeof(hAcc) / sizeof(hAcc[0]))];
+		e.sAcc    = sAcc[i % (sizeof(sAcc) / sizeof(sAcc[0]))];
+		e.heading = (int32_t) (i * 899999) % 36000000;
+		e.cAcc    = cAcc[i % (sizeof(cAcc) / sizeof(cAcc[0]))];
+		epochs.push_back(e);
+
+		if (i % 5 == 4)
+		{
+			// Crosses midnight, so the date must roll over too
+			if (++e.sec == 60)
+			{
+				e.sec  = 0;
+				e.min  = 0;
+				e.hour = 0;
+			}
+		}
+	}
+
+	return epochs;
+}
+
+static void writeTrack(const char *path, const std::vector<Epoch> &epochs)
+{
+	static const char version[] = "test";
+
+	std::ofstream out(path, std::ios::binary);
+	Track_header_t header;
+	int32_t lat = 0, lon = 0, hMSL = 0;
+	bool first = true;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACK_MAGIC, sizeof(header.magic));
+	header.version   = TRACK_VERSION;
+	header.recordLen = sizeof(Track_record_t);
+	header.headerLen = sizeof(Track_header_t) + sizeof(version);
+	header.year      = 2018;
+	header.month     = 12;
+	header.day       = 31;
+	header.hour      = epochs[0].hour;
+	header.min       = epochs[0].min;
+	header.sec       = epochs[0].sec;
+	header.hAccScale = TRACK_HACC_SCALE;
+	header.vAccScale = TRACK_VACC_SCALE;
+	header.sAccScale = TRACK_SACC_SCALE;
+	header.headScale = TRACK_HEAD_SCALE;
+	header.cAccScale = TRACK_CACC_SCALE;
+
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out.write(version, sizeof(version));
+
+	for (const Epoch &e : epochs)
+	{
+		Track_record_t rec;
+		int32_t dLat  = e.lat  - lat;
+		int32_t dLon  = e.lon  - lon;
+		int32_t dHMSL = e.hMSL - hMSL;
+
+		if (first ||
+		    dLat  != (int16_t) dLat ||
+		    dLon  != (int16_t) dLon ||
+		    dHMSL != (int16_t) dHMSL)
+		{
+			Track_key_t key;
+
+			memset(&key, 0, sizeof(key));
+			key.flags = TRACK_KEY;
+			key.lat   = e.lat;
+			key.lon   = e.lon;
+			key.hMSL  = e.hMSL;
+			out.write(reinterpret_cast<const char *>(&key), sizeof(key));
+
+			dLat = dLon = dHMSL = 0;
+			first = false;
+		}
+
+		lat  = e.lat;
+		lon  = e.lon;
+		hMSL = e.hMSL;
+
+		int32_t elapsed = ((e.hour - header.hour + 24) % 24) * 3600 +
+			(e.min - header.min) * 60 + (e.sec - header.sec);
+
+		rec.flags   = TRACK_POS | TRACK_SOL | TRACK_VEL | TRACK_TIME;
+		rec.gpsFix  = e.gpsFix;
+		rec.numSV   = e.numSV;
+		rec.csec    = (e.nano + 5000000) / 10000000;
+		rec.sec     = elapsed;
+		rec.dLat    = dLat;
+		rec.dLon    = dLon;
+		rec.dHMSL   = dHMSL;
+		rec.velN    = e.velN;
+		rec.velE    = e.velE;
+		rec.velD    = e.velD;
+		rec.heading = (e.heading + TRACK_HEAD_SCALE / 2) / TRACK_HEAD_SCALE;
+		rec.hAcc    = scale8(e.hAcc, TRACK_HACC_SCALE);
+		rec.vAcc    = scale8(e.vAcc, TRACK_VACC_SCALE);
+		rec.sAcc    = scale8(e.sAcc, TRACK_SACC_SCALE);
+		rec.cAcc    = scale8(e.cAcc, TRACK_CACC_SCALE);
+		out.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+	}
+}
+
+// Fixed-point CSV field as an integer in its smallest unit
+static int64_t parseFixed(const std::string &s)
+{
+	std::string digits;
+	for (char c : s)
+	{
+		if (c != '.') digits += c;
+	}
+	return strtoll(digits.c_str(), 0, 10);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *conv = argc > 1 ? argv[1] : "./trk2csv";
+	const char *trk = "trk2csv_test.trk";
+	const char *csv = "trk2csv_test.csv";
+
+	std::vector<Epoch> epochs = makeEpochs();
+	writeTrack(trk, epochs);
+
+	std::string cmd = std::string(conv) + " " + trk + " " + csv;
+	if (system(cmd.c_str()) != 0)
+	{
+		printf("%s failed\n", cmd.c_str());
+		return 1;
+	}
+
+	std::ifstream in(csv, std::ios::binary);
+	std::string line;
+	size_t row = 0;
+
+	std::getline(in, line); // Header
+	std::getline(in, line); // Units
+
+	while (std::getline(in, line))
+	{
+		if (row == epochs.size())
+		{
+			printf("Extra row: %s\n", line.c_str());
+			++failures;
+			break;
+		}
+
+		const Epoch &e = epochs[row];
+		std::vector<std::string> f;
+		std::stringstream ss(line.substr(0, line.find('\r')));
+		std::string field;
+
+		while (std::getline(ss, field, ','))
+		{
+			f.push_back(field);
+		}
+		if (f.size() != 14)
+		{
+			printf("Row %d: %u fields\n", (int) row, (unsigned) f.size());
+			++failures;
+			++row;
+			continue;
+		}
+
+		// Rows after midnight are on the next day
+		const bool nextDay = e.hour == 0;
+		char time[32];
+		sprintf(time, "%s-%02dT%02d:%02d:%02d.%02dZ",
+			nextDay ? "2019-01" : "2018-12", nextDay ? 1 : 31,
+			e.hour, e.min, e.sec, (e.nano + 5000000) / 10000000);
+		++checks;
+		if (f[0] != time && failures++ < 20)
+		{
+			printf("Row %d time: expected %s, got %s\n", (int) row, time, f[0].c_str());
+		}
+
+		check(row, "lat",     e.lat,     parseFixed(f[1]));
+		check(row, "lon",     e.lon,     parseFixed(f[2]));
+		check(row, "hMSL",    e.hMSL,    parseFixed(f[3]));
+		check(row, "velN",    e.velN,    parseFixed(f[4]));
+		check(row, "velE",    e.velE,    parseFixed(f[5]));
+		check(row, "velD",    e.velD,    parseFixed(f[6]));
+		check(row, "hAcc",    expectAcc(e.hAcc, TRACK_HACC_SCALE), parseFixed(f[7]));
+		check(row, "vAcc",    expectAcc(e.vAcc, TRACK_VACC_SCALE), parseFixed(f[8]));
+		check(row, "sAcc",    expectAcc(e.sAcc, TRACK_SACC_SCALE), parseFixed(f[9]));
+		check(row, "heading", (e.heading + TRACK_HEAD_SCALE / 2) / TRACK_HEAD_SCALE * TRACK_HEAD_SCALE,
+			parseFixed(f[10]));
+		check(row, "cAcc",    expectAcc(e.cAcc, TRACK_CACC_SCALE), parseFixed(f[11]));
+		check(row, "gpsFix",  e.gpsFix,  parseFixed(f[12]));
+		check(row, "numSV",   e.numSV,   parseFixed(f[13]));
+
+		++row;
+	}
+
+	if (row != epochs.size())
+	{
+		printf("Expected %u rows, got %u\n", (unsigned) epochs.size(), (unsigned) row);
+		++failures;
+	}
+
+	remove(trk);
+	remove(csv);
+
+	printf("%lu checks, %lu failures\n", checks, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Mass-storage throughput benchmark for a mounted FlySight (Linux).
+#
+# usage: usbbench.sh MOUNTPOINT [SIZE_MB]
+#
+# Writes a test file of SIZE_MB (default 4) with O_DIRECT and fsync, reads
+# it back with O_DIRECT, and prints both rates in MB/s. O_DIRECT keeps the
+# page cache out of the measurement. The test file is removed afterwards.
+# Run it on the same card before and after a firmware change.
+
+set -e
+
+if [ $# -lt 1 ] || [ ! -d "$1" ]; then
+	echo "usage: $0 MOUNTPOINT [SIZE_MB]" >&2
+	exit 1
+fi
+
+dir=$1
+size=${2:-4}
+file=$dir/usbbench.tmp
+
+rate() {
+	# Elapsed seconds from dd's summary line, turned into MB/s
+	awk -v mb="$size" '/copied/ { for (i = 1; i <= NF; i++) if ($i == "s,") print mb / $(i - 1) }'
+}
+
+trap 'rm -f "$file"' EXIT
+
+w=$(dd if=/dev/zero of="$file" bs=64k count=$((size * 16)) oflag=direct conv=fsync 2>&1 | rate)
+sync
+r=$(dd if="$file" of=/dev/null bs=64k iflag=direct 2>&1 | rate)
+
+printf 'write: %.3f MB/s\nread:  %.3f MB/s\n' "$w" "$r"